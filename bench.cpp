@@ -0,0 +1,199 @@
+
+
+// benchmark all stages of the conversion pipeline on synthetic inputs of growing size
+// output is one tab-separated line per scale & stage:
+//   species characters stage seconds items items_per_second
+// where seconds is the best of all repetitions, so the numbers can be tracked over time
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <functional>
+#include "utils/graph.hpp"
+#include "utils/intersection_graph.hpp"
+#include "utils/cut_profile.hpp"
+#include "utils/synthetic.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/distances.hpp"
+#include "io/fasta.hpp"
+#include "io/edgelist.hpp"
+#include "io/dimacs.hpp"
+#include "io/csr.hpp"
+
+struct Options
+{
+  std::vector<unsigned> species = {20, 50, 100};
+  std::vector<unsigned> characters = {500, 1000, 2000};
+  SyntheticAlignmentParams params;
+  unsigned repeat = 3;
+};
+
+void print_usage(const char* name)
+{
+  std::cout << "syntax: "<<name<<" [options]"<<std::endl
+            << "options:"<<std::endl
+            << "  --species <a,b,...>     number of species for each scale (default: 20,50,100)"<<std::endl
+            << "  --characters <a,b,...>  number of characters for each scale (default: 500,1000,2000)"<<std::endl
+            << "  --alphabet <k>          number of states per character, at most 26 (default: 4)"<<std::endl
+            << "  --gap-rate <r>          probability of a gap per species & character (default: 0.02)"<<std::endl
+            << "  --clusters <k>          number of clusters of species sharing states (default: 4)"<<std::endl
+            << "  --cluster-mutation <r>  per character mutation probability of the clusters (default: 0.1)"<<std::endl
+            << "  --species-mutation <r>  per character mutation probability of the species (default: 0.05)"<<std::endl
+            << "  --seed <s>              random seed (default: 0)"<<std::endl
+            << "  --repeat <k>            repetitions per stage, the fastest one is reported (default: 3)"<<std::endl;
+}
+
+std::vector<unsigned> parse_list(std::string s)
+{
+  std::vector<unsigned> result;
+  while(!s.empty()){
+    result.push_back(read_single_number(s));
+    skip_all(s, "," WHITESPACES);
+  }
+  return result;
+}
+
+bool parse_options(int argc, char* argv[], Options& opts)
+{
+  for(int i = 1; i < argc; ++i){
+    const std::string arg(argv[i]);
+    if((arg == "-h") || (arg == "--help") || (arg == "/?")) return false;
+    if(i + 1 == argc) throw except::invalid_options("missing argument to " + arg);
+    const std::string value(argv[++i]);
+    if(arg == "--species") opts.species = parse_list(value);
+    else if(arg == "--characters") opts.characters = parse_list(value);
+    else if(arg == "--alphabet"){
+      opts.params.alphabet = std::stoul(value);
+      if(!opts.params.alphabet || (opts.params.alphabet > SYNTHETIC_MAX_ALPHABET))
+        throw except::invalid_options("the alphabet needs between 1 and " + std::to_string(SYNTHETIC_MAX_ALPHABET) + " states");
+    }
+    else if(arg == "--gap-rate") opts.params.gap_rate = std::stod(value);
+    else if(arg == "--clusters") opts.params.clusters = std::stoul(value);
+    else if(arg == "--cluster-mutation") opts.params.cluster_mutation = std::stod(value);
+    else if(arg == "--species-mutation") opts.params.species_mutation = std::stod(value);
+    else if(arg == "--seed") opts.params.seed = std::stoul(value);
+    else if(arg == "--repeat") opts.repeat = std::max(1ul, std::stoul(value));
+    else throw except::invalid_options("unknown option " + arg);
+  }
+  if(opts.species.size() != opts.characters.size())
+    throw except::invalid_options("need as many species counts as character counts");
+  return true;
+}
+
+// run f 'repeat' times and return the fastest time in seconds; 'prepare' is run before each repetition and not timed
+double measure(const unsigned repeat, const std::function<void()>& f, const std::function<void()>& prepare = []{})
+{
+  double best = -1;
+  for(unsigned i = 0; i < repeat; ++i){
+    prepare();
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if((best < 0) || (seconds < best)) best = seconds;
+  }
+  return best;
+}
+
+void report(const unsigned species, const unsigned characters, const std::string& stage, const double seconds, const size_t items)
+{
+  std::cout << species << '\t' << characters << '\t' << stage << '\t' << seconds << '\t' << items << '\t'
+            << (seconds > 0 ? items / seconds : 0) << std::endl;
+}
+
+void run_scale(const Options& opts, const unsigned species, const unsigned characters)
+{
+  SyntheticAlignmentParams params = opts.params;
+  params.species = species;
+  params.characters = characters;
+  const std::string fasta = synthetic_alignment(params);
+  const unsigned repeat = opts.repeat;
+  double t;
+
+  SequenceArena arena;
+  t = measure(repeat, [&]{ io::read_fasta_buffer(fasta.data(), fasta.length(), arena); });
+  report(species, characters, "fasta_parse", t, fasta.length());
+
+  CharMatrix matrix;
+  t = measure(repeat, [&]{ matrix.assign(arena); });
+  report(species, characters, "char_matrix", t, (size_t)species * characters);
+
+  CharMatrix reduced;
+  t = measure(repeat, [&]{ reduced.IsolateSNIPs(); }, [&]{ reduced = matrix; });
+  report(species, characters, "isolate_snips", t, (size_t)species * characters);
+
+  t = measure(repeat, [&]{ species_distances(matrix); });
+  report(species, characters, "species_distances", t, (size_t)species * (species - 1) / 2 * characters);
+
+  // name the vertices and collect the cliques, then insert the cliques
+  Graph g;
+  std::vector<std::vector<Graph::Vertex>> cliques;
+  const auto name_vertices = [&]{
+      for(unsigned s = 0; s < species; ++s)
+        for(unsigned ch = 0; ch < characters; ++ch)
+          if(reduced[{s, ch}]) cliques[s].push_back(g.emplace_vertex_by_name(Graph::VertexName(ch, reduced[{s, ch}])));
+    };
+  const auto reset = [&]{ g.clear(); cliques.assign(species, {}); };
+  t = measure(repeat, name_vertices, reset);
+  report(species, characters, "vertex_naming", t, (size_t)species * characters);
+
+  t = measure(repeat, [&]{ for(const auto& c: cliques) g.make_clique(c); }, [&]{ reset(); name_vertices(); });
+  report(species, characters, "clique_insertion", t, g.num_edges());
+
+  t = measure(repeat, [&]{ add_species_cliques(reduced, g); }, [&]{ g.clear(); });
+  report(species, characters, "build_graph", t, g.num_edges());
+  const size_t m = g.num_edges();
+
+  // writers
+  std::string edgelist, csr;
+  t = measure(repeat, [&]{ std::ostringstream out; io::write_edgelist(out, g); edgelist = out.str(); });
+  report(species, characters, "write_edgelist", t, m);
+  t = measure(repeat, [&]{ std::ostringstream out; io::write_dimacs_graph(out, g); });
+  report(species, characters, "write_dimacs", t, m);
+  t = measure(repeat, [&]{ std::ostringstream out; io::write_csr(out, g); csr = out.str(); });
+  report(species, characters, "write_csr", t, m);
+
+  // readers
+  Graph h;
+  t = measure(repeat, [&]{ std::istringstream in(edgelist); io::read_edgelist(in, h); }, [&]{ h.clear(); });
+  report(species, characters, "read_edgelist", t, m);
+  t = measure(repeat, [&]{ std::istringstream in(csr); io::read_csr(in, h); }, [&]{ h.clear(); });
+  report(species, characters, "read_csr", t, m);
+
+  // cut_off
+  const size_t half = h.num_vertices() / 2;
+  t = measure(repeat, [&]{ std::ostringstream out; io::write_edgelist_prefix(out, h, half); });
+  report(species, characters, "cut_off", t, m);
+  t = measure(repeat, [&]{ const CutProfile profile(h); });
+  report(species, characters, "cut_profile", t, m);
+  t = measure(repeat, [&]{ Graph::VertexSet keep(h.num_vertices()); for(size_t v = 0; v < half; v += 2) keep.set(v); h.induced_subgraph(keep); });
+  report(species, characters, "induced_subgraph", t, m);
+
+  // synthetic edge lists of the same size
+  const std::string random_edges = synthetic_edgelist(g.num_vertices(), m, params.seed);
+  t = measure(repeat, [&]{ std::istringstream in(random_edges); io::read_edgelist(in, h); }, [&]{ h.clear(); });
+  report(species, characters, "read_random_edgelist", t, m);
+}
+
+int main(int argc, char* argv[])
+{
+  Options opts;
+  try{
+    if(!parse_options(argc, argv, opts)){
+      print_usage(argv[0]);
+      return 1;
+    }
+  } catch(const except::invalid_options& e){
+    std::cout << e.what() << std::endl;
+    print_usage(argv[0]);
+    return 1;
+  } catch(const std::logic_error& e){
+    std::cout << "invalid number: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::cout << "species\tcharacters\tstage\tseconds\titems\titems_per_second" << std::endl;
+  for(size_t i = 0; i < opts.species.size(); ++i)
+    run_scale(opts, opts.species[i], opts.characters[i]);
+  return 0;
+}
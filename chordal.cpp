@@ -0,0 +1,130 @@
+
+// check whether instances of chordal completion are chordal already (so they need no fill edges at all)
+// for each graph file, print one line
+//   <file> chordal
+//   <file> not chordal, chordless cycle: <v1> <v2> ... <vk>
+// vertices are given by their ids in the file; with --peo, chordal graphs are followed by a line
+//   peo: <v1> <v2> ... <vn>
+// listing a perfect elimination ordering of the vertices that occur in the file
+
+#include <iostream>
+#include <vector>
+#include <numeric>
+#include "utils/graph.hpp"
+#include "utils/chordal.hpp"
+#include "utils/stats.hpp"
+#include "io/edgelist.hpp"
+#include "io/csr.hpp"
+
+struct Options
+{
+  bool csr = false;           // the graph files are in binary CSR format
+  bool peo = false;           // print a perfect elimination ordering of chordal graphs
+  std::string stats_file;     // write statistics as JSON to this file ("-" = stderr)
+  std::vector<std::string> in_files;
+};
+
+void print_usage(const char* name)
+{
+  std::cout << "syntax: "<<name<<" [options] <graph file> [graph file...]"<<std::endl
+            << "options:"<<std::endl
+            << "  --csr            the graph files are in binary CSR format instead of edge lists"<<std::endl
+            << "  --peo            print a perfect elimination ordering for each chordal graph"<<std::endl
+            << "  --stats <file>   write timings & counters as JSON to <file> (- for stderr)"<<std::endl;
+}
+
+// parse the command line into opts, return false if the program should not continue
+bool parse_options(int argc, char* argv[], Options& opts)
+{
+  for(int i = 1; i < argc; ++i){
+    const std::string arg(argv[i]);
+    if((arg == "-h") || (arg == "--help") || (arg == "/?")) return false;
+    if(arg.substr(0, 2) == "--"){
+      if(arg == "--csr") opts.csr = true;
+      else if(arg == "--peo") opts.peo = true;
+      else if(arg == "--stats") {
+        if(i + 1 == argc) throw except::invalid_options("missing argument to " + arg);
+        opts.stats_file = argv[++i];
+      } else throw except::invalid_options("unknown option " + arg);
+    } else opts.in_files.push_back(arg);
+  }
+  return !opts.in_files.empty();
+}
+
+// write the collected statistics to the given file ("-" = stderr, "" = nowhere)
+void write_stats(const std::string& stats_file)
+{
+  if(stats_file == "-")
+    stats::write_json(std::cerr);
+  else if(!stats_file.empty()){
+    std::ofstream os(stats_file);
+    stats::write_json(os);
+  }
+}
+
+// read the graph in in_file into g, filling vertex_ids with the id in the file of each vertex
+bool read_graph(const Options& opts, const std::string& in_file, Graph& g, std::vector<unsigned>& vertex_ids)
+{
+  const stats::ScopedTimer timer("read_graph");
+  std::ifstream in(in_file, std::ios::binary);
+  if(!in.good()) {
+    std::cout << in_file << " cannot be read"<<std::endl;
+    return false;
+  }
+  if(opts.csr){
+    if(!io::read_csr(in, g)) return false;
+    vertex_ids.resize(g.num_vertices());
+    std::iota(vertex_ids.begin(), vertex_ids.end(), 0);
+    return true;
+  } else return io::read_edgelist(in, g, &vertex_ids);
+}
+
+int main(int argc, char* argv[])
+{
+  Options opts;
+  try{
+    if(!parse_options(argc, argv, opts)){
+      print_usage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  } catch(const except::invalid_options& e){
+    std::cout << e.what() << std::endl;
+    print_usage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  size_t chordal = 0;
+  bool failed = false;
+  for(const std::string& in_file: opts.in_files){
+    Graph g;
+    std::vector<unsigned> vertex_ids;
+    if(!read_graph(opts, in_file, g, vertex_ids)){
+      failed = true;
+      continue;
+    }
+    stats::count("vertices", g.num_vertices());
+    stats::count("edges", g.num_edges());
+
+    stats::ScopedTimer timer("recognize");
+    const ChordalityResult result = recognize_chordal(g);
+    timer.stop();
+    if(result.chordal){
+      ++chordal;
+      std::cout << in_file << " chordal"<<std::endl;
+      if(opts.peo){
+        std::cout << "peo:";
+        for(const Graph::Vertex v: result.peo) std::cout << ' ' << vertex_ids[v];
+        std::cout << std::endl;
+      }
+    } else {
+      std::cout << in_file << " not chordal, chordless cycle:";
+      for(const Graph::Vertex v: result.cycle) std::cout << ' ' << vertex_ids[v];
+      std::cout << std::endl;
+    }
+  }
+  stats::count("graphs", opts.in_files.size());
+  stats::count("chordal", chordal);
+  write_stats(opts.stats_file);
+
+  exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -8,35 +8,217 @@
 
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 #include "utils/graph.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/cut_profile.hpp"
+#include "utils/stats.hpp"
 #include "io/fasta.hpp"
 //#include "io/dimacs.hpp"
 #include "io/edgelist.hpp"
 
+struct Options
+{
+  std::vector<unsigned> thresholds;
+  unsigned threads = 1;
+  bool compact = false;       // drop isolated vertices and renumber the remaining ones consecutively
+  bool profile = false;       // print the instance-size profile of all thresholds
+  size_t target_edges = -1;    // pick the largest threshold whose cut has at most this many edges
+  size_t target_vertices = -1; // pick the largest threshold whose cut has at most this many non-isolated vertices
+  std::string stats_file;      // write statistics as JSON to this file ("-" = stderr)
+  std::string in_file;
+  std::string out_file;
+};
+
+void print_usage(const char* name)
+{
+  std::cout << "syntax: "<<name<<" [options] <graph file> <threshold index>[,<threshold index>...] [output file]"<<std::endl
+            << "   or:  "<<name<<" --profile <graph file> [output file]"<<std::endl
+            << "   or:  "<<name<<" --target-edges <m> | --target-vertices <n> <graph file> [output file]"<<std::endl
+            << "  for each threshold t, the subgraph induced by the vertices of index < t is written"<<std::endl
+            << "  if multiple thresholds are given, the output for t goes to <output file>.<t>"<<std::endl
+            << "options:"<<std::endl
+            << "  --threads <k>          write up to k outputs in parallel (default: 1)"<<std::endl
+            << "  --compact              drop isolated vertices from each cut and renumber the others consecutively"<<std::endl
+            << "  --profile              print the number of edges & non-isolated vertices of the cut at each threshold"<<std::endl
+            << "  --target-edges <m>     cut at the largest threshold with at most m edges"<<std::endl
+            << "  --target-vertices <n>  cut at the largest threshold with at most n non-isolated vertices"<<std::endl
+            << "  --stats <file>         write timings & counters as JSON to <file> (- for stderr)"<<std::endl;
+}
+
+// parse a comma separated list of thresholds, return them sorted and without repetitions
+// (so no two threads write the same output file)
+std::vector<unsigned> parse_thresholds(std::string s)
+{
+  std::vector<unsigned> result;
+  while(!s.empty()){
+    result.push_back(read_single_number(s));
+    skip_all(s, "," WHITESPACES);
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+bool targets_given(const Options& opts)
+{
+  return (opts.target_edges != (size_t)-1) || (opts.target_vertices != (size_t)-1);
+}
+
+// parse the command line into opts, return false if the program should not continue
+bool parse_options(int argc, char* argv[], Options& opts)
+{
+  std::vector<std::string> positional;
+  for(int i = 1; i < argc; ++i){
+    const std::string arg(argv[i]);
+    if((arg == "-h") || (arg == "--help") || (arg == "/?")) return false;
+    if(arg.substr(0, 2) == "--"){
+      if(arg == "--profile"){
+        opts.profile = true;
+        continue;
+      }
+      if(arg == "--compact"){
+        opts.compact = true;
+        continue;
+      }
+      if(i + 1 == argc) throw except::invalid_options("missing argument to " + arg);
+      const std::string value(argv[++i]);
+      if(arg == "--threads"){
+        opts.threads = std::stoul(value);
+        if(!opts.threads) throw except::invalid_options("need at least one thread");
+      } else if(arg == "--target-edges") opts.target_edges = std::stoul(value);
+      else if(arg == "--target-vertices") opts.target_vertices = std::stoul(value);
+      else if(arg == "--stats") opts.stats_file = value;
+      else throw except::invalid_options("unknown option " + arg);
+    } else positional.push_back(arg);
+  }
+  // in profile & target modes, there is no threshold argument
+  const bool thresholds_given = !opts.profile && !targets_given(opts);
+  if((positional.size() < 1u + thresholds_given) || (positional.size() > 2u + thresholds_given)) return false;
+  opts.in_file = positional[0];
+  if(thresholds_given) opts.thresholds = parse_thresholds(positional[1]);
+  if(positional.size() > 1u + thresholds_given) opts.out_file = positional.back();
+  if(opts.profile && targets_given(opts)) throw except::invalid_options("--profile cannot be combined with target sizes");
+  return true;
+}
+
+// write the cut of g at threshold t to os
+void write_cut(std::ostream& os, const Graph& g, const unsigned t, const bool compact)
+{
+  if(compact){
+    // collect the vertices that have an edge in the cut & extract the subgraph they induce
+    Graph::VertexSet non_isolated(g.num_vertices());
+    g.for_each_edge([&non_isolated](const size_t u, const size_t v){ non_isolated.set(u); non_isolated.set(v); }, t);
+    io::write_edgelist(os, g.induced_subgraph(non_isolated));
+  } else io::write_edgelist_prefix(os, g, t);
+}
+
+// write the collected statistics to the given file ("-" = stderr, "" = nowhere)
+void write_stats(const std::string& stats_file)
+{
+  if(stats_file == "-")
+    stats::write_json(std::cerr);
+  else if(!stats_file.empty()){
+    std::ofstream os(stats_file);
+    stats::write_json(os);
+  }
+}
+
+// write the cuts for all thresholds, distributing them over the given number of threads;
+// return false if an output file could not be written
+bool write_cuts(const Options& opts, const Graph& g)
+{
+  const stats::ScopedTimer timer("write");
+  stats::count("cuts", opts.thresholds.size());
+  const bool multiple = (opts.thresholds.size() > 1);
+  if(opts.out_file.empty()){
+    // all cuts go to stdout, one after the other
+    for(const unsigned t: opts.thresholds) if(t > 0){
+      if(multiple) std::cout << "# threshold "<<t<<std::endl;
+      write_cut(std::cout, g, t, opts.compact);
+    }
+    return true;
+  } else {
+    std::atomic<unsigned> next(0);
+    std::atomic<bool> failed(false);
+    const auto worker = [&](){
+      for(unsigned i = next++; i < opts.thresholds.size(); i = next++){
+        const unsigned t = opts.thresholds[i];
+        if(t > 0){
+          DEBUG1(std::cout << "cutting off vertices of index >= "<<t<<std::endl);
+          const std::string out_file = multiple ? opts.out_file + "." + std::to_string(t) : opts.out_file;
+          std::ofstream os(out_file);
+          if(os.good()) write_cut(os, g, t, opts.compact);
+          if(!os.good()){
+            std::cerr << "cannot write "<<out_file<<std::endl;
+            failed = true;
+          }
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    for(unsigned i = 1; i < std::min<size_t>(opts.threads, opts.thresholds.size()); ++i)
+      workers.emplace_back(worker);
+    worker();
+    for(auto& w: workers) w.join();
+    return !failed;
+  }
+}
+
 int main(int argc, char* argv[])
 {
-  if((argc < 3) || (std::string(argv[1]) == "-h") || (std::string(argv[1]) == "--help") || (std::string(argv[1]) == "/?")){
-    std::cout << "syntax: "<<argv[0]<<" <graph file> <threshold index> [output file]"<<std::endl;
+  Options opts;
+  try{
+    if(!parse_options(argc, argv, opts)){
+      print_usage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  } catch(const except::invalid_options& e){
+    std::cout << e.what() << std::endl;
+    print_usage(argv[0]);
     exit(EXIT_FAILURE);
-  } else {
-    Graph g;
-    DEBUG1(std::cout << "reading graph..."<<std::endl);
-    std::ifstream in_file(argv[1]);
+  } catch(const std::logic_error& e){
+    std::cout << "invalid number: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  Graph g;
+  DEBUG1(std::cout << "reading graph..."<<std::endl);
+  {
+    const stats::ScopedTimer timer("read_graph");
+    std::ifstream in_file(opts.in_file);
     io::read_edgelist(in_file, g);
-    const unsigned threshold = std::atoi(argv[2]);
-    
-    if(threshold > 0){
-      DEBUG1(std::cout << "cutting off vertices of index > "<<threshold<<std::endl);
-      DEBUG3(std::cout << "currently, "<<g.num_edges()<<" edges"<<std::endl);
-      for(unsigned i = g.num_vertices() - 1; i >= threshold; --i)
-        g.isolate_vertex(i);
-
-      if(argc > 3){
-        std::ofstream os(argv[3]);
-        io::write_edgelist(os, g);
-      } else io::write_edgelist(std::cout, g);
-    }
+  }
+  DEBUG3(std::cout << "currently, "<<g.num_edges()<<" edges"<<std::endl);
+  stats::count("vertices", g.num_vertices());
+  stats::count("edges", g.num_edges());
 
-    exit(EXIT_SUCCESS);
+  if(opts.profile || targets_given(opts)){
+    stats::ScopedTimer timer("profile");
+    const CutProfile profile(g);
+    timer.stop();
+    if(opts.profile){
+      if(opts.out_file.empty())
+        std::cout << profile;
+      else {
+        std::ofstream os(opts.out_file);
+        if(!(os << profile)){
+          std::cerr << "cannot write "<<opts.out_file<<std::endl;
+          exit(EXIT_FAILURE);
+        }
+      }
+      write_stats(opts.stats_file);
+      exit(EXIT_SUCCESS);
+    }
+    const size_t t = profile.find_threshold(opts.target_edges, opts.target_vertices);
+    std::cerr << "threshold "<<t<<": "<<profile.num_edges[t]<<" edges, "<<profile.num_vertices[t]<<" vertices"<<std::endl;
+    opts.thresholds.assign(1, t);
   }
+
+  const bool written = write_cuts(opts, g);
+  write_stats(opts.stats_file);
+
+  exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -0,0 +1,135 @@
+
+/* ----------------------------------------------------------------- */
+/*
+  Reads & writes graphs in a compact binary CSR (compressed sparse row) format:
+
+    char     magic[8]                  "PACECSR1"
+    uint64_t num_vertices
+    uint64_t num_edges
+    uint64_t offsets[num_vertices + 1]
+    uint32_t neighbors[num_edges]
+
+  neighbors[offsets[u]] ... neighbors[offsets[u+1]-1] are the neighbors v < u of u in increasing order,
+  so each edge is stored exactly once. All numbers are stored in host byte order.
+*/
+/* ----------------------------------------------------------------- */
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <numeric>
+
+#include "utils/exceptions.hpp"
+
+#define CSR_MAGIC "PACECSR1"
+#define CSR_MAGIC_LENGTH 8
+
+namespace io {
+
+  // write a CSR file edge by edge; edges (u,v) with v < u have to be added in increasing order of (u,v)
+  // NOTE: the output stream has to be seekable since the offsets are only known in the end
+  class CSRWriter
+  {
+  protected:
+    std::ostream& out;
+    const std::streampos start;
+    std::vector<uint64_t> offsets;
+    uint64_t num_edges = 0;
+
+    template<typename T>
+    void write_raw(const T* data, const size_t count)
+    {
+      out.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+    }
+
+    void write_header()
+    {
+      const uint64_t num_vertices = offsets.size() - 1;
+      out.write(CSR_MAGIC, CSR_MAGIC_LENGTH);
+      write_raw(&num_vertices, 1);
+      write_raw(&num_edges, 1);
+      write_raw(offsets.data(), offsets.size());
+    }
+  public:
+    CSRWriter(std::ostream& _out, const size_t num_vertices):
+      out(_out), start(_out.tellp()), offsets(num_vertices + 1, 0)
+    {
+      // write a placeholder header, to be overwritten in finish()
+      write_header();
+    }
+
+    void add_edge(const uint32_t larger, const uint32_t smaller)
+    {
+      assert(smaller < larger);
+      ++offsets[larger + 1];
+      ++num_edges;
+      write_raw(&smaller, 1);
+    }
+
+    void finish()
+    {
+      std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+      const std::streampos end = out.tellp();
+      out.seekp(start);
+      write_header();
+      out.seekp(end);
+      if(!out.good()) throw except::invalid_options("could not write CSR output (output not seekable?)");
+    }
+  };
+
+
+  // write the graph g to the outstream "out" in binary CSR format
+  template<typename Graph, typename Vertex = typename Graph::Vertex, typename Edge = typename Graph::Edge>
+  void write_csr(std::ostream& out, const Graph& g){
+    CSRWriter writer(out, g.num_vertices());
+    for(auto ur = g.vertices(); ur.first != ur.second; ++ur.first){
+      const Vertex& u = *ur.first;
+      const size_t u_idx = g.get_index(u);
+      for(auto vr = g.adjacent_vertices(u); vr.first != vr.second; ++vr.first){
+        const size_t v_idx = g.get_index(*vr.first);
+        if(v_idx < u_idx) writer.add_edge(u_idx, v_idx);
+      }
+    }
+    writer.finish();
+  } // function
+
+
+  // read a graph in binary CSR format from the instream "in" into the (empty) graph g
+  template<typename Graph, typename Vertex = typename Graph::Vertex, typename Edge = typename Graph::Edge>
+  bool read_csr(std::istream& in, Graph& g){
+    char magic[CSR_MAGIC_LENGTH];
+    uint64_t num_vertices, num_edges;
+    in.read(magic, CSR_MAGIC_LENGTH);
+    in.read(reinterpret_cast<char*>(&num_vertices), sizeof(uint64_t));
+    in.read(reinterpret_cast<char*>(&num_edges), sizeof(uint64_t));
+    if(!in.good() || std::strncmp(magic, CSR_MAGIC, CSR_MAGIC_LENGTH)){
+      std::cout << "not a CSR file"<<std::endl;
+      return false;
+    }
+    std::vector<uint64_t> offsets(num_vertices + 1);
+    std::vector<uint32_t> neighbors(num_edges);
+    in.read(reinterpret_cast<char*>(offsets.data()), sizeof(uint64_t) * offsets.size());
+    in.read(reinterpret_cast<char*>(neighbors.data()), sizeof(uint32_t) * neighbors.size());
+    if(!in.good() || (offsets.back() != num_edges)){
+      std::cout << "truncated or corrupt CSR file"<<std::endl;
+      return false;
+    }
+    std::vector<Vertex> verts;
+    verts.reserve(num_vertices);
+    for(uint64_t u = 0; u < num_vertices; ++u) verts.push_back(g.add_vertex());
+    for(uint64_t u = 0; u < num_vertices; ++u)
+      for(uint64_t i = offsets[u]; i < offsets[u + 1]; ++i){
+        if(neighbors[i] >= u){
+          std::cout << "corrupt CSR file: neighbor "<<neighbors[i]<<" of "<<u<<" out of order"<<std::endl;
+          return false;
+        }
+        g.add_edge(verts[u], verts[neighbors[i]]);
+      }
+    return true;
+  } // function
+
+} // namespace
+
@@ -10,28 +10,38 @@
 
 
 #include "utils/exceptions.hpp"
+#include "utils/stats.hpp"
 
 namespace io {
 
 
   // read a graph from the instream "in", return the number of vertices & edges read
+  // vertices are numbered in order of their first appearance; if vertex_ids is given, it receives the id in the file of each vertex
   template<typename Graph, typename Vertex = typename Graph::Vertex, typename Edge = typename Graph::Edge>
-  bool read_edgelist(std::istream& in, Graph& g){
+  bool read_edgelist(std::istream& in, Graph& g, std::vector<unsigned>* vertex_ids = NULL){
     DEBUG1(std::cout << "reading edgelist"<<std::endl);
     boost::unordered_map<unsigned, Vertex> idx_to_vertex;
     unsigned line_no = 0;
+    size_t bytes_read = 0;
     std::string in_line;
 
     while(std::getline(in, in_line)){
       ++line_no;
+      bytes_read += in_line.length() + 1;
       if(in_line[0] != '#'){// skip comments
         unsigned u_idx, v_idx;
         if(std::sscanf(in_line.c_str(), "%u %u", &u_idx, &v_idx) == 2){
           if(u_idx != v_idx){ // no self-loops please
             auto u_iter = idx_to_vertex.find(u_idx);
-            if(u_iter == idx_to_vertex.end()) u_iter = idx_to_vertex.emplace_hint(u_iter, u_idx, g.add_vertex());
+            if(u_iter == idx_to_vertex.end()) {
+              u_iter = idx_to_vertex.emplace_hint(u_iter, u_idx, g.add_vertex());
+              if(vertex_ids) vertex_ids->push_back(u_idx);
+            }
             auto v_iter = idx_to_vertex.find(v_idx);
-            if(v_iter == idx_to_vertex.end()) v_iter = idx_to_vertex.emplace_hint(v_iter, v_idx, g.add_vertex());
+            if(v_iter == idx_to_vertex.end()) {
+              v_iter = idx_to_vertex.emplace_hint(v_iter, v_idx, g.add_vertex());
+              if(vertex_ids) vertex_ids->push_back(v_idx);
+            }
             g.add_edge(u_iter->second, v_iter->second);
           }
         } else {
@@ -40,6 +50,7 @@ namespace io {
         }
       }
     }
+    stats::count("bytes_read", bytes_read);
     return true;
   }
 
@@ -68,4 +79,12 @@ namespace io {
     }
   } // function
 
+  // write the subgraph of g induced by the vertices of index < vertex_bound to the outstream "out"
+  // this filters the edges uv by max(u,v) < vertex_bound while scanning the adjacency matrix word by word
+  template<typename Graph>
+  void write_edgelist_prefix(std::ostream& out, const Graph& g, const size_t vertex_bound){
+    g.for_each_edge([&out](const size_t u_idx, const size_t v_idx){ out << v_idx << " " << u_idx << '\n'; }, vertex_bound);
+    out.flush();
+  } // function
+
 } // namespace
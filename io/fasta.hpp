@@ -4,26 +4,30 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
 
 #include "utils/exceptions.hpp"
 #include "utils/sequences.hpp"
 #include "utils/string_utils.hpp" // for trim
+#include "utils/stats.hpp"
 
 #define FASTA_MAX_LINELENGTH 79
 
 namespace io {
 
   // read a fasta file into an associative name_to_seq mapping a sequence name to its sequence
-  void read_fasta_file(std::istream& input, SequenceMap& name_to_seq, const std::string& acceptable_bases = "")
+  inline void read_fasta_file(std::istream& input, SequenceMap& name_to_seq, const std::string& acceptable_bases = "")
   {
     SequenceMap::iterator current_entry;
     bool success;
     unsigned line_no = 0;
+    size_t bytes_read = 0;
     std::string line; // input buffer
     
     name_to_seq.clear();
     while(std::getline(input, line).good()){
       ++line_no;
+      bytes_read += line.length() + 1;
       if(!line.empty()){
         if(line[0] == '>'){
           // if the line starts with '>' it's a sequence name
@@ -45,16 +49,127 @@ namespace io {
         }// if
       }// if line not empty
     }// while file contains data
+    stats::count("bytes_read", bytes_read);
+    name_to_seq.account_strings();
   }// function
 
-  void read_fasta_file(const std::string& input, SequenceMap& name_to_seq, const std::string& acceptable_bases = "")
+  inline void read_fasta_file(const std::string& input, SequenceMap& name_to_seq, const std::string& acceptable_bases = "")
   {
     std::ifstream in_stream(input);
     read_fasta_file(in_stream, name_to_seq, acceptable_bases);
   }
 
+  // a read-only stream buffer over a block of memory, to parse in-memory data without copying it
+  struct MemoryBuffer: public std::streambuf
+  {
+    MemoryBuffer(const char* data, const size_t length)
+    {
+      char* const begin = const_cast<char*>(data);
+      setg(begin, begin, begin + length);
+    }
+  };
+
+  // read fasta formatted data from memory
+  inline void read_fasta_buffer(const char* data, const size_t length, SequenceMap& name_to_seq, const std::string& acceptable_bases = "")
+  {
+    MemoryBuffer buffer(data, length);
+    std::istream in_stream(&buffer);
+    read_fasta_file(in_stream, name_to_seq, acceptable_bases);
+  }
+
+  // summary of a fasta file, obtained by scanning it without storing any sequence
+  struct FastaSummary
+  {
+    size_t num_records = 0;
+    size_t max_length = 0;   // length of the longest sequence
+    size_t total_length = 0; // sum of the lengths of all sequences
+    size_t num_symbols = 0;  // number of distinct symbols occuring in the sequences
+    size_t name_length = 0;  // sum of the lengths of all sequence names (untrimmed)
+  };
+
+  inline FastaSummary scan_fasta_file(std::istream& input)
+  {
+    FastaSummary result;
+    size_t current_length = 0;
+    bool seen[256] = {false};
+    std::string line; // input buffer
+    while(std::getline(input, line).good()){
+      if(!line.empty()){
+        if(line[0] == '>'){
+          ++result.num_records;
+          result.name_length += line.length() - 1;
+          current_length = 0;
+        } else {
+          current_length += line.length();
+          result.total_length += line.length();
+          result.max_length = std::max(result.max_length, current_length);
+          for(const char c: line) seen[(unsigned char)c] = true;
+        }
+      }
+    }
+    result.num_symbols = std::count(seen, seen + 256, true);
+    return result;
+  }
+
+  inline FastaSummary scan_fasta_file(const std::string& input)
+  {
+    std::ifstream in_stream(input);
+    return scan_fasta_file(in_stream);
+  }
+
+  // read a fasta file into an arena, keeping the names and sequences in the order of the file
+  inline void read_fasta_file(std::istream& input, SequenceArena& arena, const std::string& acceptable_bases = "")
+  {
+    unsigned line_no = 0;
+    size_t bytes_read = 0;
+    std::string line; // input buffer
+
+    arena.clear();
+    while(std::getline(input, line).good()){
+      ++line_no;
+      bytes_read += line.length() + 1;
+      if(!line.empty()){
+        if(line[0] == '>'){
+          // if the line starts with '>' it's a sequence name, remove leading and trailing whitespaces
+          const size_t first = line.find_first_not_of(WHITESPACES, 1);
+          if(first == std::string::npos) throw except::bad_syntax(line_no, "empty sequence name");
+          const size_t last = line.find_last_not_of(WHITESPACES);
+          if(!arena.add_record(line.data() + first, last - first + 1))
+            throw except::bad_syntax(line_no, (std::string)"repeated sequence name: " + line.substr(first, last - first + 1));
+        } else {
+          // if the line is not empty and does not start with '>', then it's part of the sequence
+          if(arena.empty()) throw except::bad_syntax(line_no, "missing sequence name");
+          if(!acceptable_bases.empty())
+            if(line.find_first_not_of(acceptable_bases) != std::string::npos)
+              throw except::bad_syntax(line_no, (std::string)"contains a base that's not in " + acceptable_bases);
+          arena.append(line.data(), line.length());
+        }// if
+      }// if line not empty
+    }// while file contains data
+    stats::count("bytes_read", bytes_read);
+  }
+
+  // read a fasta file into an arena; the file is scanned first, so the arena can be allocated in one go
+  inline void read_fasta_file(const std::string& input, SequenceArena& arena, const std::string& acceptable_bases = "")
+  {
+    std::ifstream in_stream(input);
+    const FastaSummary summary = scan_fasta_file(in_stream);
+    arena.reserve(summary.num_records, summary.name_length + summary.total_length);
+    in_stream.clear();
+    in_stream.seekg(0);
+    read_fasta_file(in_stream, arena, acceptable_bases);
+  }
+
+  // read fasta formatted data from memory into an arena
+  inline void read_fasta_buffer(const char* data, const size_t length, SequenceArena& arena, const std::string& acceptable_bases = "")
+  {
+    MemoryBuffer buffer(data, length);
+    std::istream in_stream(&buffer);
+    read_fasta_file(in_stream, arena, acceptable_bases);
+  }
+
   // write the sequences into a fasta file 
-  void write_sequence_map(std::ostream& out, SequenceMap& name_to_seq)
+  inline void write_sequence_map(std::ostream& out, SequenceMap& name_to_seq)
   {
     for(const auto& name_seq: name_to_seq){
       out << ">" << name_seq.first << std::endl;
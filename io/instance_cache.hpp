@@ -0,0 +1,130 @@
+
+/* ----------------------------------------------------------------- */
+/*
+  A content-addressed on-disk cache of converted instances. An entry is identified by a key (the hash of the
+  input matrix and of the options that influence the output) and consists of the files
+
+    <dir>/<key>.graph         the graph, in whatever format it was written
+    <dir>/<key>.<sidecar>     any number of sidecar files (for example the reduction log)
+    <dir>/<key>.info          "PACECACHE1" followed by lines "<name> <value>" (for example the number of edges)
+
+  Each file is written to a temporary file and renamed into place, the info file last, so an entry is complete
+  iff its info file exists, even if several processes fill the cache at the same time.
+*/
+/* ----------------------------------------------------------------- */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "utils/exceptions.hpp"
+
+#define CACHE_MAGIC "PACECACHE1"
+
+namespace io {
+
+  class InstanceCache
+  {
+  public:
+    typedef std::vector<std::pair<std::string, uint64_t>> Info;
+    // pairs (sidecar name, file name of the sidecar in the output)
+    typedef std::vector<std::pair<std::string, std::string>> Sidecars;
+
+  protected:
+    const std::string dir;
+
+    std::string entry_file(const std::string& key, const std::string& suffix) const
+    {
+      return dir + "/" + key + "." + suffix;
+    }
+
+    // copy everything in the file 'from' to the stream 'to', return false if 'from' cannot be read
+    static bool copy_file(const std::string& from, std::ostream& to)
+    {
+      std::ifstream in(from, std::ios::binary);
+      if(!in.good()) return false;
+      if(in.peek() != std::ifstream::traits_type::eof()) to << in.rdbuf();
+      return to.good();
+    }
+
+    // atomically create the file 'name' in the cache with the contents written by 'write'
+    template<class Writer>
+    void put_file(const std::string& name, Writer&& write) const
+    {
+      std::string tmp_name = name + ".XXXXXX";
+      const int fd = mkstemp(&tmp_name[0]);
+      if(fd < 0) throw except::invalid_options("could not create a file in the cache " + dir);
+      close(fd);
+      bool written;
+      {
+        std::ofstream out(tmp_name, std::ios::binary);
+        written = write(out) && out.flush().good();
+      }
+      if(!written || std::rename(tmp_name.c_str(), name.c_str())){
+        std::remove(tmp_name.c_str());
+        throw except::invalid_options("could not write " + name);
+      }
+    }
+
+  public:
+    //! open the cache in the directory _dir, creating the directory if it does not exist
+    InstanceCache(const std::string& _dir): dir(_dir)
+    {
+      if(mkdir(dir.c_str(), 0777) && (errno != EEXIST))
+        throw except::invalid_options("cannot create cache directory " + dir);
+    }
+
+    //! the key of an instance, given the hash of its contents and a description of the options
+    static std::string make_key(const uint64_t content_hash, const std::string& options)
+    {
+      // FNV-1a, as for the contents
+      uint64_t options_hash = 14695981039346656037ULL;
+      for(const char c: options) options_hash = (options_hash ^ (unsigned char)c) * 1099511628211ULL;
+      std::ostringstream key;
+      key << std::hex << std::setfill('0') << std::setw(16) << content_hash << '-' << std::setw(16) << options_hash;
+      return key.str();
+    }
+
+    //! if the entry 'key' exists, write its graph to graph_out, copy its sidecars and read its info, return false otherwise
+    /** NOTE: graph_out may have been written to if the entry vanishes while it is being read **/
+    bool fetch(const std::string& key, std::ostream& graph_out, const Sidecars& sidecars, Info& info) const
+    {
+      std::ifstream info_in(entry_file(key, "info"));
+      std::string magic;
+      if(!(info_in >> magic) || (magic != CACHE_MAGIC)) return false;
+      info.clear();
+      std::string name;
+      uint64_t value;
+      while(info_in >> name >> value) info.emplace_back(name, value);
+
+      for(const auto& sidecar: sidecars){
+        std::ofstream out(sidecar.second, std::ios::binary);
+        if(!copy_file(entry_file(key, sidecar.first), out)) return false;
+      }
+      return copy_file(entry_file(key, "graph"), graph_out);
+    }
+
+    //! add the entry 'key' with the graph in graph_file, the given sidecars and info
+    void store(const std::string& key, const std::string& graph_file, const Sidecars& sidecars, const Info& info) const
+    {
+      put_file(entry_file(key, "graph"), [&](std::ostream& out){ return copy_file(graph_file, out); });
+      for(const auto& sidecar: sidecars)
+        put_file(entry_file(key, sidecar.first), [&](std::ostream& out){ return copy_file(sidecar.second, out); });
+      put_file(entry_file(key, "info"), [&](std::ostream& out){
+          out << CACHE_MAGIC << '\n';
+          for(const auto& entry: info) out << entry.first << ' ' << entry.second << '\n';
+          return true;
+        });
+    }
+  };
+
+} // namespace
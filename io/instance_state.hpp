@@ -0,0 +1,88 @@
+
+/* ----------------------------------------------------------------- */
+/*
+  Reads & writes the state of a conversion, so more species can be appended to it later:
+
+    char     magic[8]                  "PACEINC1"
+    uint64_t num_species
+    uint64_t num_characters
+    char     columns[num_characters]   '\0' for informative characters, otherwise the state of the first species
+    (graph in binary CSR format, see csr.hpp)
+    uint32_t characters[num_vertices]  the name (character, state) of each vertex
+    char     states[num_vertices]
+
+  All numbers are stored in host byte order.
+*/
+/* ----------------------------------------------------------------- */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+#include "utils/exceptions.hpp"
+#include "io/csr.hpp"
+
+#define STATE_MAGIC "PACEINC1"
+#define STATE_MAGIC_LENGTH 8
+
+namespace io {
+
+  // write the intersection graph g of num_species species to the (seekable) outstream "out",
+  // along with the description of the characters as computed by CharMatrix::IsolateSNIPs()
+  template<typename Graph>
+  void write_instance_state(std::ostream& out, const Graph& g, const std::string& columns, const uint64_t num_species)
+  {
+    const uint64_t num_characters = columns.size();
+    out.write(STATE_MAGIC, STATE_MAGIC_LENGTH);
+    out.write(reinterpret_cast<const char*>(&num_species), sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(&num_characters), sizeof(uint64_t));
+    out.write(columns.data(), columns.size());
+    write_csr(out, g);
+
+    const auto names = g.vertex_names();
+    std::vector<uint32_t> characters(names.size());
+    std::vector<char> states(names.size());
+    for(size_t v = 0; v < names.size(); ++v){
+      characters[v] = names[v].first;
+      states[v] = names[v].second;
+    }
+    out.write(reinterpret_cast<const char*>(characters.data()), sizeof(uint32_t) * characters.size());
+    out.write(states.data(), states.size());
+    if(!out.good()) throw except::invalid_options("could not write the instance state");
+  } // function
+
+
+  // read a state written by write_instance_state() from the instream "in" into the (empty) graph g and columns,
+  // return the number of species
+  template<typename Graph, typename VertexName = typename Graph::VertexName>
+  uint64_t read_instance_state(std::istream& in, Graph& g, std::string& columns)
+  {
+    char magic[STATE_MAGIC_LENGTH];
+    uint64_t num_species, num_characters;
+    in.read(magic, STATE_MAGIC_LENGTH);
+    in.read(reinterpret_cast<char*>(&num_species), sizeof(uint64_t));
+    in.read(reinterpret_cast<char*>(&num_characters), sizeof(uint64_t));
+    if(!in.good() || std::strncmp(magic, STATE_MAGIC, STATE_MAGIC_LENGTH))
+      throw except::read_error(0, "not an instance state file");
+    columns.resize(num_characters);
+    in.read(&columns[0], num_characters);
+    if(!in.good() || !read_csr(in, g)) throw except::read_error(0, "truncated or corrupt instance state file");
+
+    std::vector<uint32_t> characters(g.num_vertices());
+    std::vector<char> states(g.num_vertices());
+    in.read(reinterpret_cast<char*>(characters.data()), sizeof(uint32_t) * characters.size());
+    in.read(states.data(), states.size());
+    if(!in.good()) throw except::read_error(0, "truncated instance state file");
+    for(size_t v = 0; v < characters.size(); ++v){
+      if((characters[v] >= num_characters) || columns[characters[v]])
+        throw except::read_error(0, "corrupt instance state file: vertex " + std::to_string(v) + " belongs to no informative character");
+      g.set_name(v, VertexName(characters[v], states[v]));
+    }
+    return num_species;
+  } // function
+
+} // namespace
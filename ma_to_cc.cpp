@@ -8,42 +8,860 @@
 
 #include <iostream>
 #include <vector>
+#include <chrono>
+#include <numeric>
+#include <dirent.h>
 #include "utils/graph.hpp"
+#include "utils/intersection_graph.hpp"
+#include "utils/external_edges.hpp"
+#include "utils/reduction.hpp"
+#include "utils/treewidth.hpp"
+#include "utils/reorder.hpp"
+#include "utils/subsample.hpp"
+#include "utils/windows.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/stats.hpp"
 #include "io/fasta.hpp"
 //#include "io/dimacs.hpp"
 #include "io/edgelist.hpp"
+#include "io/csr.hpp"
+#include "io/instance_cache.hpp"
+#include "io/instance_state.hpp"
+
+struct Options
+{
+  size_t external_budget = 0; // memory budget in bytes for out-of-core construction (0 = in-memory)
+  std::string tmp_dir;
+  bool csr = false;
+  bool reduce = false;        // remove simplicial vertices & merge twins before writing the graph
+  std::string components;     // if non-empty, also write each connected component to <components>.<i>.edges
+  bool bounds = false;        // compute bounds on treewidth & minimum fill-in of the graph
+  VertexOrder order = ORDER_NONE; // renumber the vertices before writing the graph
+  std::string cache_dir;      // if non-empty, reuse & store converted instances in this directory
+  std::string save_state;     // if non-empty, write the state needed to append species later to this file
+  std::string append_state;   // if non-empty, append the species of the input to the instance in this state file
+  std::string subsample;      // if non-empty, write the sub-instances listed in this file instead of the whole instance
+  size_t window = 0;          // if positive, write the instance of each window of this many characters instead of the whole instance
+  size_t step = 0;            // distance between the starts of consecutive windows (0 = window length)
+  std::string batch;          // manifest file or directory of fasta files to convert in batch mode
+  std::string out_dir = ".";  // output directory in batch mode
+  unsigned threads = std::thread::hardware_concurrency();
+  size_t memory_budget = -1;  // global memory budget in bytes for batch mode
+  std::string stats_file;     // write statistics as JSON to this file ("-" = stderr)
+  std::string in_file;
+  std::string out_file;
+};
+
+void print_usage(const char* name)
+{
+  std::cout << "syntax: "<<name<<" [options] <file in fasta format> [output file]"<<std::endl
+            << "   or:  "<<name<<" [options] --batch <manifest or directory> [--out-dir <dir>]"<<std::endl
+            << "options:"<<std::endl
+            << "  --external <MB>   construct the graph out-of-core, buffering at most <MB> megabytes of edges"<<std::endl
+            << "  --tmp-dir <dir>   directory for temporary edge runs (default: system temp dir)"<<std::endl
+            << "  --csr             write the graph in binary CSR format (requires an output file)"<<std::endl
+            << "  --reduce          remove simplicial vertices & merge true twins, writing the reduction log to <output file>.reduction;"<<std::endl
+            << "                    a merged vertex carries the characters of its twins, listed as 'c <vertex> <character>' in the log,"<<std::endl
+            << "                    and must not be joined to a vertex of these characters"<<std::endl
+            << "  --components <prefix>  also write each connected component (with at least one edge) to <prefix>.<i>.edges (or .csr),"<<std::endl
+            << "                    and a manifest <prefix>.manifest mapping component vertices to global vertices & (character, state)"<<std::endl
+            << "  --order <order>   renumber the vertices by 'degeneracy', 'rcm' (reverse Cuthill-McKee) or 'character' before writing;"<<std::endl
+            << "                    <output file>.perm lists the vertex before renumbering of each vertex"<<std::endl
+            << "  --cache <dir>     look up the instance in the cache <dir> before converting it & store it there afterwards;"<<std::endl
+            << "                    instances are identified by their sequences (regardless of their order or line breaks) & the options"<<std::endl
+            << "  --save-state <file>  write the (unreduced) graph, its vertex names & characters to <file>, so species can be appended later"<<std::endl
+            << "                    (not available with --cache)"<<std::endl
+            << "  --append <file>   add the species of the input to the instance saved in the state file <file> instead of"<<std::endl
+            << "                    converting it from scratch (combine with --save-state to update the state)"<<std::endl
+            << "  --subsample <file>  write the sub-instances (species subsets & character windows) listed in <file> to"<<std::endl
+            << "                    <output file>.<i>.edges (or .csr) and a summary to <output file>.manifest; each line of <file> is"<<std::endl
+            << "                      all | random <k> <seed> [<count>] | species <name> [<name>...]"<<std::endl
+            << "                    optionally followed by 'chars <first> <end>' to keep only the characters first, ..., end-1"<<std::endl
+            << "  --window <length> write the instance of each window of <length> characters to <output file>.<i>.edges (or .csr)"<<std::endl
+            << "                    and a summary to <output file>.manifest; characters may have at most 64 states"<<std::endl
+            << "  --step <k>        start a window every <k> characters (default: the window length)"<<std::endl
+            << "  --bounds          compute treewidth & fill-in bounds (min-degree, min-fill, minor-min-width) into the statistics"<<std::endl
+            << "  --batch <source>  convert all fasta files listed in the manifest <source> (one per line) or contained in the directory <source>"<<std::endl
+            << "  --out-dir <dir>   write batch outputs & summary.tsv to <dir> (default: .)"<<std::endl
+            << "  --threads <k>     number of conversions running concurrently in batch mode (default: #cores)"<<std::endl
+            << "  --memory <MB>     global memory budget in batch mode; large inputs wait until enough of it is free"<<std::endl
+            << "  --stats <file>    write timings & counters as JSON to <file> (- for stderr)"<<std::endl;
+}
+
+// parse the command line into opts, return false if the program should not continue
+bool parse_options(int argc, char* argv[], Options& opts)
+{
+  std::vector<std::string> positional;
+  for(int i = 1; i < argc; ++i){
+    const std::string arg(argv[i]);
+    if((arg == "-h") || (arg == "--help") || (arg == "/?")) return false;
+    if(arg.substr(0, 2) == "--"){
+      if(arg == "--csr") {
+        opts.csr = true;
+        continue;
+      }
+      if(arg == "--reduce") {
+        opts.reduce = true;
+        continue;
+      }
+      if(arg == "--bounds") {
+        opts.bounds = true;
+        continue;
+      }
+      if(i + 1 == argc) throw except::invalid_options("missing argument to " + arg);
+      const std::string value(argv[++i]);
+      if(arg == "--external") {
+        opts.external_budget = std::stoul(value) << 20;
+        if(!opts.external_budget) throw except::invalid_options("memory budget must be positive");
+      } else if(arg == "--tmp-dir") opts.tmp_dir = value;
+      else if(arg == "--batch") opts.batch = value;
+      else if(arg == "--out-dir") opts.out_dir = value;
+      else if(arg == "--stats") opts.stats_file = value;
+      else if(arg == "--components") opts.components = value;
+      else if(arg == "--order") opts.order = parse_vertex_order(value);
+      else if(arg == "--cache") opts.cache_dir = value;
+      else if(arg == "--save-state") opts.save_state = value;
+      else if(arg == "--append") opts.append_state = value;
+      else if(arg == "--subsample") opts.subsample = value;
+      else if(arg == "--window") {
+        opts.window = std::stoul(value);
+        if(!opts.window) throw except::invalid_options("windows need at least one character");
+      } else if(arg == "--step") {
+        opts.step = std::stoul(value);
+        if(!opts.step) throw except::invalid_options("the step between windows must be positive");
+      }
+      else if(arg == "--threads") {
+        opts.threads = std::stoul(value);
+        if(!opts.threads) throw except::invalid_options("need at least one thread");
+      } else if(arg == "--memory") opts.memory_budget = std::stoul(value) << 20;
+      else throw except::invalid_options("unknown option " + arg);
+    } else positional.push_back(arg);
+  }
+  if(opts.reduce && opts.external_budget) throw except::invalid_options("reduction is not available for out-of-core construction");
+  if((opts.order != ORDER_NONE) && opts.external_budget) throw except::invalid_options("reordering is not available for out-of-core construction");
+  if(opts.bounds && opts.external_budget) throw except::invalid_options("bounds are not available for out-of-core construction");
+  if(!opts.components.empty() && opts.external_budget) throw except::invalid_options("components are not available for out-of-core construction");
+  if(!opts.components.empty() && !opts.batch.empty()) throw except::invalid_options("components are not available in batch mode");
+  if(!opts.components.empty() && !opts.cache_dir.empty()) throw except::invalid_options("components are not cached");
+  if(!(opts.save_state.empty() && opts.append_state.empty())){
+    if(opts.external_budget) throw except::invalid_options("instance states are not available for out-of-core construction");
+    if(!opts.batch.empty()) throw except::invalid_options("instance states are not available in batch mode");
+  }
+  if(!opts.append_state.empty() && !opts.cache_dir.empty()) throw except::invalid_options("appended instances are not cached");
+  if(!opts.save_state.empty() && !opts.cache_dir.empty()) throw except::invalid_options("instance states are not written for cached instances");
+  if(opts.step && !opts.window) throw except::invalid_options("--step requires --window");
+  if(!opts.subsample.empty() && opts.window) throw except::invalid_options("use either sub-instances or windows");
+  if((!opts.subsample.empty() || opts.window) && (opts.external_budget || !opts.batch.empty() || opts.reduce || (opts.order != ORDER_NONE) || opts.bounds
+                                 || !opts.components.empty() || !opts.cache_dir.empty() || !opts.save_state.empty() || !opts.append_state.empty()))
+    throw except::invalid_options("sub-instances & windows can only be combined with --csr, --threads & --stats");
+  if(!opts.batch.empty()) return positional.empty();
+  if(positional.empty() || (positional.size() > 2)) return false;
+  opts.in_file = positional[0];
+  if(positional.size() > 1) opts.out_file = positional[1];
+  if(opts.csr && opts.out_file.empty()) throw except::invalid_options("CSR output requires an output file");
+  if(opts.reduce && opts.out_file.empty()) throw except::invalid_options("reduction requires an output file");
+  if((opts.order != ORDER_NONE) && opts.out_file.empty()) throw except::invalid_options("reordering requires an output file");
+  if(!opts.cache_dir.empty() && opts.out_file.empty()) throw except::invalid_options("caching requires an output file");
+  if((!opts.subsample.empty() || opts.window) && opts.out_file.empty()) throw except::invalid_options("sub-instances & windows require an output file");
+  return true;
+}
+
+// read the fasta file into a matrix of all characters, with the species in canonical order (by sequence, then by name),
+// so the instance does not depend on the order of the records
+CharMatrix* read_raw_char_matrix(const std::string& filename)
+{
+  DEBUG1(std::cout << "reading sequences..."<<std::endl);
+  SequenceArena arena;
+  {
+    const stats::ScopedTimer timer("read_fasta");
+    io::read_fasta_file(filename, arena);
+  }
+  if(arena.empty()) throw except::read_error(0, "no sequences found in " + filename);
+  const stats::ScopedTimer timer("char_matrix");
+  CharMatrix* sequences = new CharMatrix();
+  sequences->assign(arena, arena.canonical_order());
+  return sequences;
+}
+
+// read the fasta file and reduce it to the informative characters
+// if content_hash is given, it receives the hash of the reduced matrix (which includes the removed characters)
+// if columns is given, it receives the description of the characters computed by IsolateSNIPs()
+CharMatrix* read_char_matrix(const std::string& filename, uint64_t* content_hash = NULL, std::string* columns = NULL)
+{
+  CharMatrix* sequences = read_raw_char_matrix(filename);
+  {
+    const stats::ScopedTimer timer("isolate_snips");
+    stats::count("species", sequences->size().first);
+    stats::count("characters", sequences->size().second);
+    stats::count("characters_kept", sequences->IsolateSNIPs(columns));
+  }
+  if(content_hash){
+    const stats::ScopedTimer timer("content_hash");
+    *content_hash = sequences->content_hash();
+  }
+  return sequences;
+}
+
+// sizes of a converted instance
+struct ConversionResult
+{
+  size_t species = 0;
+  size_t characters = 0;
+  size_t vertices = 0;
+  size_t edges = 0;
+  TreewidthBounds bounds;     // only computed with --bounds
+};
+
+// build the intersection graph out-of-core and stream it to os
+void convert_external(const Options& opts, const CharMatrix& sequences, std::ostream& os, ConversionResult& result)
+{
+  ExternalEdgeGraph g(opts.external_budget, opts.tmp_dir);
+  {
+    const stats::ScopedTimer timer("build_graph");
+    add_species_cliques(sequences, g);
+  }
+  DEBUG1(std::cout << "merging "<<g.num_runs()<<" edge runs..."<<std::endl);
+  const stats::ScopedTimer timer("merge_and_write");
+  stats::count("edge_runs", g.num_runs());
+  result.vertices = g.num_vertices();
+  size_t& num_edges = result.edges;
+  if(opts.csr){
+    io::CSRWriter writer(os, g.num_vertices());
+    g.merge_edges([&](const uint32_t u, const uint32_t v){ writer.add_edge(u, v); ++num_edges; });
+    writer.finish();
+  } else g.merge_edges([&](const uint32_t u, const uint32_t v){ os << v << " " << u << "\n"; ++num_edges; });
+}
+
+// write the connected components of g that have at least one edge to <prefix>.<i>.edges (or .csr) in parallel,
+// as well as the manifest <prefix>.manifest listing "<component> <vertex> <global vertex> <character> <state>"
+// NOTE: single vertices need no completion, so they are not written
+void write_components(const Options& opts, const Graph& g, UnionFind& components)
+{
+  const std::vector<size_t> component = components.set_ids();
+  const std::vector<Graph> parts = g.split(component, components.num_sets());
+  std::vector<size_t> file_index(parts.size(), -1);
+  std::vector<size_t> written;
+  for(size_t i = 0; i < parts.size(); ++i)
+    if(parts[i].num_edges()){
+      file_index[i] = written.size();
+      written.push_back(i);
+    }
+  stats::count("components", parts.size());
+  stats::count("components_written", written.size());
+  DEBUG1(std::cout << "writing "<<written.size()<<" of "<<parts.size()<<" components"<<std::endl);
+
+  std::atomic<bool> failed(false);
+  {
+    ThreadPool pool(opts.threads);
+    pool.parallel_for(written.size(), [&](const size_t i){
+        std::ofstream os(opts.components + "." + std::to_string(i) + (opts.csr ? ".csr" : ".edges"), std::ios::binary);
+        if(!os.good()) {
+          failed = true;
+          return;
+        }
+        if(opts.csr) io::write_csr(os, parts[written[i]]); else io::write_edgelist(os, parts[written[i]]);
+      });
+  }
+  if(failed) throw except::invalid_options("cannot write components to " + opts.components);
+
+  // list the vertices of each component in order of their local index, which is the order of their global index
+  std::vector<std::vector<Graph::Vertex>> global(written.size());
+  for(size_t v = 0; v < component.size(); ++v)
+    if(file_index[component[v]] != (size_t)-1) global[file_index[component[v]]].push_back(v);
+  const std::vector<Graph::VertexName> names = g.vertex_names();
+  std::ofstream manifest(opts.components + ".manifest");
+  manifest << "# component vertex global_vertex character state"<<std::endl;
+  for(size_t i = 0; i < global.size(); ++i)
+    for(size_t local = 0; local < global[i].size(); ++local){
+      const Graph::Vertex v = global[i][local];
+      manifest << i << ' ' << local << ' ' << v << ' ' << names[v].first << ' ' << names[v].second << '\n';
+    }
+}
+
+// write the permutation sidecar: for each vertex of the reordered graph, the vertex it was before
+void write_permutation(const std::string& filename, const Graph& g, const std::vector<Graph::Vertex>& ordering)
+{
+  const std::vector<Graph::VertexName> names = g.vertex_names();
+  std::ofstream os(filename);
+  os << "# vertex old_vertex character state"<<std::endl;
+  for(size_t i = 0; i < ordering.size(); ++i)
+    os << i << ' ' << ordering[i] << ' ' << names[ordering[i]].first << ' ' << names[ordering[i]].second << '\n';
+}
+
+// write the state of the conversion of num_species species to opts.save_state
+void save_state(const Options& opts, const Graph& g, const std::string& columns, const size_t num_species)
+{
+  const stats::ScopedTimer timer("save_state");
+  std::ofstream os(opts.save_state, std::ios::binary);
+  if(!os.good()) throw except::invalid_options("cannot write " + opts.save_state);
+  io::write_instance_state(os, g, columns, num_species);
+}
+
+// reduce, reorder & write the intersection graph g to os; out_file is the name of the output, used for the
+// reduction log (<out_file>.reduction) and the permutation (<out_file>.perm)
+void write_graph(const Options& opts, Graph& g, UnionFind& components, std::ostream& os, ConversionResult& result,
+                 const std::string& out_file)
+{
+  if(opts.reduce){
+    const stats::ScopedTimer timer("reduce");
+    const Reduction reduction(g);
+    std::ofstream log(out_file + ".reduction");
+    reduction.write_log(log, g);
+    g = reduction.reduced_graph(g);
+    // the reduction may split components, so recompute them from the edges of the reduced graph
+    if(!opts.components.empty()){
+      components = UnionFind(g.num_vertices());
+      g.for_each_edge([&components](const size_t u, const size_t v){ components.unite(u, v); });
+    }
+  }
+  if(opts.order != ORDER_NONE){
+    const stats::ScopedTimer timer("reorder");
+    const std::vector<Graph::Vertex> ordering = vertex_ordering(g, opts.order);
+    write_permutation(out_file + ".perm", g, ordering);
+    g = g.relabeled(ordering_to_index(ordering));
+    // the components refer to the old numbering, so relabel them as well
+    if(!opts.components.empty()){
+      components = UnionFind(g.num_vertices());
+      g.for_each_edge([&components](const size_t u, const size_t v){ components.unite(u, v); });
+    }
+  }
+  result.vertices = g.num_vertices();
+  result.edges = g.num_edges();
+  {
+    const stats::ScopedTimer timer("write");
+    if(opts.csr) io::write_csr(os, g); else io::write_edgelist(os, g);
+  }
+  if(!opts.components.empty()){
+    const stats::ScopedTimer timer("write_components");
+    write_components(opts, g, components);
+  }
+  if(opts.bounds){
+    const stats::ScopedTimer timer("bounds");
+    // in batch mode, the conversions run in parallel already
+    result.bounds = treewidth_bounds(g, opts.batch.empty() ? opts.threads : 1);
+  }
+}
+
+// build the intersection graph in memory and write it to os; columns describes the characters of the matrix
+// as computed by IsolateSNIPs() and is only needed to save the state
+void convert_in_memory(const Options& opts, const CharMatrix& sequences, std::ostream& os, ConversionResult& result,
+                       const std::string& out_file, const std::string& columns)
+{
+  Graph g;
+  UnionFind components;
+  {
+    const stats::ScopedTimer timer("build_graph");
+    add_species_cliques(sequences, g, opts.components.empty() ? NULL : &components);
+  }
+  if(!opts.save_state.empty()) save_state(opts, g, columns, result.species);
+  write_graph(opts, g, components, os, result, out_file);
+}
+
+// add the species in in_file to the instance saved in opts.append_state and write the result to os
+void append_species(const Options& opts, const std::string& in_file, std::ostream& os, ConversionResult& result,
+                    const std::string& out_file)
+{
+  Graph g;
+  std::string columns;
+  {
+    const stats::ScopedTimer timer("read_state");
+    std::ifstream in(opts.append_state, std::ios::binary);
+    if(!in.good()) throw except::invalid_options("cannot read " + opts.append_state);
+    result.species = io::read_instance_state(in, g, columns);
+  }
+  {
+    CharMatrix* sequences = read_raw_char_matrix(in_file);
+    const size_t num_chars = sequences->size().second;
+    if(num_chars != columns.size()){
+      delete sequences;
+      throw except::invalid_options(in_file + " has " + std::to_string(num_chars) + " characters, but the instance in "
+                                    + opts.append_state + " has " + std::to_string(columns.size()));
+    }
+    result.species += sequences->size().first;
+    const stats::ScopedTimer timer("append_species");
+    append_species_cliques(*sequences, columns, g);
+    delete sequences;
+  }
+  result.characters = columns.size();
+  stats::count("species", result.species);
+  stats::count("characters", result.characters);
+  stats::count("characters_kept", std::count(columns.begin(), columns.end(), 0));
+  if(!opts.save_state.empty()) save_state(opts, g, columns, result.species);
+
+  UnionFind components;
+  if(!opts.components.empty()){
+    components = UnionFind(g.num_vertices());
+    g.for_each_edge([&components](const size_t u, const size_t v){ components.unite(u, v); });
+  }
+  write_graph(opts, g, components, os, result, out_file);
+}
+
+// ========================== instance cache =========================
+
+// the options that influence the output, as part of the cache key
+std::string cache_options(const Options& opts)
+{
+  return std::string("csr=") + std::to_string(opts.csr) + " reduce=" + std::to_string(opts.reduce)
+    + " order=" + std::to_string(opts.order) + " bounds=" + std::to_string(opts.bounds);
+}
+
+// the sidecar files written next to out_file
+io::InstanceCache::Sidecars cache_sidecars(const Options& opts, const std::string& out_file)
+{
+  io::InstanceCache::Sidecars result;
+  if(opts.reduce) result.emplace_back("reduction", out_file + ".reduction");
+  if(opts.order != ORDER_NONE) result.emplace_back("perm", out_file + ".perm");
+  return result;
+}
+
+// if the cache has the instance 'key', copy it to os & the sidecars of out_file and return true
+bool fetch_cached(const Options& opts, const std::string& key, std::ostream& os, const std::string& out_file, ConversionResult& result)
+{
+  const stats::ScopedTimer timer("cache_fetch");
+  io::InstanceCache::Info info;
+  if(!io::InstanceCache(opts.cache_dir).fetch(key, os, cache_sidecars(opts, out_file), info)) return false;
+  for(const auto& entry: info){
+    if(entry.first == "vertices") result.vertices = entry.second;
+    else if(entry.first == "edges") result.edges = entry.second;
+    else if(entry.first == "treewidth_lower_mmw") result.bounds.lower_mmw = entry.second;
+    else if(entry.first == "treewidth_upper_min_degree") result.bounds.min_degree.width = entry.second;
+    else if(entry.first == "treewidth_upper_min_fill") result.bounds.min_fill.width = entry.second;
+    else if(entry.first == "fill_upper_min_degree") result.bounds.min_degree.fill = entry.second;
+    else if(entry.first == "fill_upper_min_fill") result.bounds.min_fill.fill = entry.second;
+  }
+  return true;
+}
+
+// store the instance written to out_file (and os) in the cache; failing to do so is not an error
+void store_cached(const Options& opts, const std::string& key, std::ostream& os, const std::string& out_file, const ConversionResult& result)
+{
+  const stats::ScopedTimer timer("cache_store");
+  io::InstanceCache::Info info = {{"vertices", result.vertices}, {"edges", result.edges}};
+  if(opts.bounds){
+    info.emplace_back("treewidth_lower_mmw", result.bounds.lower_mmw);
+    info.emplace_back("treewidth_upper_min_degree", result.bounds.min_degree.width);
+    info.emplace_back("treewidth_upper_min_fill", result.bounds.min_fill.width);
+    info.emplace_back("fill_upper_min_degree", result.bounds.min_degree.fill);
+    info.emplace_back("fill_upper_min_fill", result.bounds.min_fill.fill);
+  }
+  os.flush();
+  try{
+    io::InstanceCache(opts.cache_dir).store(key, out_file, cache_sidecars(opts, out_file), info);
+  } catch(const except::invalid_options& e){
+    std::cout << "warning: "<<e.what()<<std::endl;
+  }
+}
+
+// ===================================================================
+
+// convert the matrix in the fasta file in_file into an instance written to os, unless it is in the cache
+void convert_matrix(const Options& opts, const std::string& in_file, std::ostream& os, ConversionResult& result,
+                    const std::string& out_file)
+{
+  uint64_t content_hash;
+  std::string columns;
+  CharMatrix* sequences = read_char_matrix(in_file, opts.cache_dir.empty() ? NULL : &content_hash,
+                                           opts.save_state.empty() ? NULL : &columns);
+  result.species = sequences->size().first;
+  result.characters = sequences->size().second;
+  try{
+    // the key covers the reduced matrix in its canonical species order, which determines the instance
+    const std::string cache_key = opts.cache_dir.empty() ? "" : io::InstanceCache::make_key(content_hash, cache_options(opts));
+    if(!cache_key.empty() && fetch_cached(opts, cache_key, os, out_file, result)){
+      stats::count("cache_hits");
+    } else {
+      if(opts.external_budget)
+        convert_external(opts, *sequences, os, result);
+      else
+        convert_in_memory(opts, *sequences, os, result, out_file, columns);
+      if(!cache_key.empty()){
+        stats::count("cache_misses");
+        store_cached(opts, cache_key, os, out_file, result);
+      }
+    }
+  } catch(...) {
+    delete sequences;
+    throw;
+  }
+  delete sequences;
+}
+
+// convert the fasta file in_file into an instance written to os
+ConversionResult convert(const Options& opts, const std::string& in_file, std::ostream& os, const std::string& out_file = "")
+{
+  ConversionResult result;
+  if(!opts.append_state.empty())
+    append_species(opts, in_file, os, result, out_file);
+  else
+    convert_matrix(opts, in_file, os, result, out_file);
+  stats::count("vertices", result.vertices);
+  stats::count("edges", result.edges);
+  if(opts.bounds){
+    // in batch mode, these are the maxima over all instances
+    stats::count_max("treewidth_lower_mmw", result.bounds.lower_mmw);
+    stats::count_max("treewidth_upper_min_degree", result.bounds.min_degree.width);
+    stats::count_max("treewidth_upper_min_fill", result.bounds.min_fill.width);
+    stats::count_max("fill_upper_min_degree", result.bounds.min_degree.fill);
+    stats::count_max("fill_upper_min_fill", result.bounds.min_fill.fill);
+  }
+  return result;
+}
+
+// ========================== sub-instances ==========================
+
+// read the sub-instances listed in spec_file, given the names of the species of the matrix
+std::vector<SubInstanceSpec> read_subsample_spec(const std::string& spec_file, const std::vector<std::string>& species_names)
+{
+  std::ifstream in(spec_file);
+  if(!in.good()) throw except::invalid_options("cannot open " + spec_file);
+  boost::unordered_map<std::string, unsigned> species_index;
+  for(unsigned i = 0; i < species_names.size(); ++i) species_index.emplace(species_names[i], i);
+
+  std::vector<SubInstanceSpec> result;
+  std::string line;
+  unsigned line_no = 0;
+  while(std::getline(in, line)){
+    ++line_no;
+    line = trim(line);
+    if(line.empty() || (line[0] == '#')) continue;
+    std::istringstream tokens(line);
+    std::vector<std::string> args;
+    for(std::string token; tokens >> token;) args.push_back(token);
+
+    SubInstanceSpec spec;
+    spec.description = line;
+    std::string window;
+    // the optional character window in the end
+    const auto chars = std::find(args.begin(), args.end(), "chars");
+    if(chars != args.end()){
+      if(args.end() - chars != 3) throw except::bad_syntax(line_no, "expected 'chars <first> <end>' in the end of the line");
+      spec.first_char = std::stoul(chars[1]);
+      spec.end_char = std::stoul(chars[2]);
+      if(spec.first_char >= spec.end_char) throw except::bad_syntax(line_no, "empty character window");
+      window = " chars " + chars[1] + " " + chars[2];
+      args.erase(chars, args.end());
+    }
+    if(args.empty()) throw except::bad_syntax(line_no, "missing species selection");
+
+    if(args[0] == "all"){
+      if(args.size() != 1) throw except::bad_syntax(line_no, "'all' takes no arguments");
+      spec.species.resize(species_names.size());
+      std::iota(spec.species.begin(), spec.species.end(), 0);
+      result.push_back(spec);
+    } else if(args[0] == "random"){
+      if((args.size() < 3) || (args.size() > 4)) throw except::bad_syntax(line_no, "expected 'random <k> <seed> [<count>]'");
+      const size_t k = std::stoul(args[1]);
+      const unsigned seed = std::stoul(args[2]);
+      const size_t count = (args.size() == 4) ? std::stoul(args[3]) : 1;
+      if(k > species_names.size())
+        throw except::bad_syntax(line_no, "cannot choose " + args[1] + " of " + std::to_string(species_names.size()) + " species");
+      for(size_t i = 0; i < count; ++i){
+        spec.species = random_species_subset(species_names.size(), k, seed + i);
+        spec.description = "random " + args[1] + " " + std::to_string(seed + i) + window;
+        result.push_back(spec);
+      }
+    } else if(args[0] == "species"){
+      for(size_t i = 1; i < args.size(); ++i){
+        const auto index = species_index.find(args[i]);
+        if(index == species_index.end()) throw except::bad_syntax(line_no, "unknown species " + args[i]);
+        spec.species.push_back(index->second);
+      }
+      std::sort(spec.species.begin(), spec.species.end());
+      spec.species.erase(std::unique(spec.species.begin(), spec.species.end()), spec.species.end());
+      result.push_back(spec);
+    } else throw except::bad_syntax(line_no, "unknown species selection " + args[0]);
+  }
+  return result;
+}
+
+// sizes of a sub-instance, for the manifest
+struct SubInstanceResult
+{
+  size_t species = 0;
+  size_t characters_kept = 0;
+  size_t vertices = 0;
+  size_t edges = 0;
+  std::string description;
+};
+
+// write the i-th sub-instance g to <out_file>.<i>.edges (or .csr), recording its size in result; return false on failure
+bool write_sub_instance(const Options& opts, const size_t i, const Graph& g, SubInstanceResult& result)
+{
+  result.vertices = g.num_vertices();
+  result.edges = g.num_edges();
+  std::ofstream os(opts.out_file + "." + std::to_string(i) + (opts.csr ? ".csr" : ".edges"), std::ios::binary);
+  if(!os.good()) return false;
+  if(opts.csr) io::write_csr(os, g); else io::write_edgelist(os, g);
+  return true;
+}
+
+// write the manifest <out_file>.manifest listing "<i> <species> <characters_kept> <vertices> <edges> <description>"
+void write_sub_instance_manifest(const Options& opts, const std::vector<SubInstanceResult>& results)
+{
+  std::ofstream manifest(opts.out_file + ".manifest");
+  manifest << "# instance species characters_kept vertices edges description"<<std::endl;
+  for(size_t i = 0; i < results.size(); ++i)
+    manifest << i << ' ' << results[i].species << ' ' << results[i].characters_kept << ' ' << results[i].vertices
+             << ' ' << results[i].edges << ' ' << results[i].description << '\n';
+}
+
+// write the sub-instances of the alignment in opts.in_file listed in opts.subsample to <out_file>.<i>.edges (or .csr)
+// in parallel, and their manifest
+void write_sub_instances(const Options& opts)
+{
+  DEBUG1(std::cout << "reading sequences..."<<std::endl);
+  CharMatrix sequences;
+  std::vector<std::string> species_names;
+  {
+    SequenceArena arena;
+    {
+      const stats::ScopedTimer timer("read_fasta");
+      io::read_fasta_file(opts.in_file, arena);
+    }
+    if(arena.empty()) throw except::read_error(0, "no sequences found in " + opts.in_file);
+    const stats::ScopedTimer timer("char_matrix");
+    const std::vector<unsigned> records = arena.canonical_order();
+    sequences.assign(arena, records);
+    for(const unsigned r: records) species_names.push_back(arena.name(r));
+  }
+  stats::count("species", sequences.size().first);
+  stats::count("characters", sequences.size().second);
+  std::vector<SubInstanceSpec> specs = read_subsample_spec(opts.subsample, species_names);
+  for(SubInstanceSpec& spec: specs)
+    spec.species = sub_alignment_order(spec.species, sequences, species_names, spec.first_char, spec.end_char);
+
+  stats::ScopedTimer timer("species_masks");
+  const SpeciesMasks masks(sequences);
+  timer.stop();
+  stats::count("mask_vertices", masks.num_vertices());
+
+  std::vector<SubInstanceResult> results(specs.size());
+  std::atomic<bool> failed(false);
+  {
+    const stats::ScopedTimer timer("sub_instances");
+    ThreadPool pool(opts.threads);
+    pool.parallel_for(specs.size(), [&](const size_t i){
+        const SubInstanceSpec& spec = specs[i];
+        results[i].species = spec.species.size();
+        results[i].description = spec.description;
+        const Graph g = masks.sub_instance(spec.species, spec.first_char, spec.end_char, &results[i].characters_kept);
+        if(!write_sub_instance(opts, i, g, results[i])) failed = true;
+      });
+  }
+  if(failed) throw except::invalid_options("cannot write sub-instances to " + opts.out_file);
+  stats::count("sub_instances", specs.size());
+  write_sub_instance_manifest(opts, results);
+}
+
+// write the instance of each window of opts.window characters of the alignment in opts.in_file to <out_file>.<i>.edges
+// (or .csr), and their manifest; the windows are split into one block of consecutive windows per thread
+void write_windows(const Options& opts)
+{
+  std::unique_ptr<CharMatrix> sequences(read_raw_char_matrix(opts.in_file));
+  const size_t num_species = sequences->size().first;
+  stats::count("species", num_species);
+  stats::count("characters", sequences->size().second);
+
+  stats::ScopedTimer timer("character_states");
+  const CharacterStates states(*sequences);
+  std::vector<unsigned> species(num_species);
+  std::iota(species.begin(), species.end(), 0);
+  std::vector<bool> informative(states.num_characters());
+  for(size_t ch = 0; ch < informative.size(); ++ch){
+    informative[ch] = states.is_informative(ch, species);
+    if(informative[ch] && (states.num_states(ch) > WINDOW_MAX_STATES))
+      throw except::invalid_options("character " + std::to_string(ch) + " has " + std::to_string(states.num_states(ch))
+                                    + " states, but windows support at most " + std::to_string(WINDOW_MAX_STATES));
+  }
+  timer.stop();
+
+  const std::vector<CharacterWindow> windows = sliding_windows(states.num_characters(), opts.window, opts.step ? opts.step : opts.window);
+  std::vector<SubInstanceResult> results(windows.size());
+  std::atomic<bool> failed(false);
+  {
+    const stats::ScopedTimer timer("windows");
+    const size_t num_blocks = std::min<size_t>(opts.threads, windows.size());
+    ThreadPool pool(opts.threads);
+    pool.parallel_for(num_blocks, [&](const size_t block){
+        WindowSweep sweep(states, informative, species, opts.window);
+        for(size_t i = block * windows.size() / num_blocks; i < (block + 1) * windows.size() / num_blocks; ++i){
+          sweep.advance(windows[i].first);
+          results[i].species = num_species;
+          results[i].description = "chars " + std::to_string(windows[i].first) + " " + std::to_string(windows[i].second);
+          const Graph g = sweep.graph(&results[i].characters_kept);
+          if(!write_sub_instance(opts, i, g, results[i])) failed = true;
+        }
+      });
+  }
+  if(failed) throw except::invalid_options("cannot write windows to " + opts.out_file);
+  stats::count("windows", windows.size());
+  write_sub_instance_manifest(opts, results);
+}
+
+// ========================== batch mode =============================
+
+// return the files listed in the manifest or contained in the directory 'source'
+std::vector<std::string> list_batch_inputs(const std::string& source)
+{
+  std::vector<std::string> result;
+  DIR* dir = opendir(source.c_str());
+  if(dir){
+    while(const dirent* entry = readdir(dir)){
+      const std::string name(entry->d_name);
+      const size_t dot = name.rfind('.');
+      if(dot == std::string::npos) continue;
+      const std::string ext = name.substr(dot + 1);
+      if((ext == "fa") || (ext == "fas") || (ext == "fasta") || (ext == "fna") || (ext == "faa"))
+        result.push_back(source + "/" + name);
+    }
+    closedir(dir);
+    std::sort(result.begin(), result.end());
+  } else {
+    std::ifstream manifest(source);
+    if(!manifest.good()) throw except::invalid_options("cannot open batch source " + source);
+    std::string line;
+    while(std::getline(manifest, line)){
+      line = trim(line);
+      if(!line.empty() && (line[0] != '#')) result.push_back(line);
+    }
+  }
+  return result;
+}
+
+// rough upper bound on the memory needed to convert the given fasta file in memory, computed by scanning the file
+memory::Estimate estimate_memory(const std::string& filename)
+{
+  const io::FastaSummary summary = io::scan_fasta_file(filename);
+  return memory::Estimate(summary.num_records, summary.max_length, summary.total_length, summary.num_symbols);
+}
+
+// return the output file for the input file in_file in batch mode
+std::string batch_output_name(const Options& opts, const std::string& in_file)
+{
+  std::string base = in_file.substr(in_file.rfind('/') + 1);
+  const size_t dot = base.rfind('.');
+  if(dot != std::string::npos) base.erase(dot);
+  return opts.out_dir + "/" + base + (opts.csr ? ".csr" : ".edges");
+}
+
+// convert many fasta files concurrently on a thread pool, largest inputs first
+int run_batch(const Options& opts)
+{
+  struct BatchEntry
+  {
+    std::string in_file;
+    std::string out_file;
+    size_t estimate = 0;
+    ConversionResult result;
+    double seconds = 0;
+    std::string status = "ok";
+  };
+
+  const std::vector<std::string> inputs = list_batch_inputs(opts.batch);
+  std::vector<BatchEntry> entries(inputs.size());
+  for(size_t i = 0; i < inputs.size(); ++i){
+    entries[i].in_file = inputs[i];
+    entries[i].out_file = batch_output_name(opts, inputs[i]);
+    entries[i].estimate = estimate_memory(inputs[i]).peak();
+  }
+  // schedule the largest inputs first, so small ones fill the gaps in the end
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b){ return entries[a].estimate > entries[b].estimate; });
+
+  DEBUG1(std::cout << "converting "<<entries.size()<<" files on "<<opts.threads<<" threads"<<std::endl);
+  MemoryBudget budget(opts.memory_budget);
+  {
+    ThreadPool pool(opts.threads);
+    for(const size_t i: order){
+      pool.submit([&opts, &budget, &entries, i]{
+          BatchEntry& entry = entries[i];
+          const MemoryReservation reservation(budget, entry.estimate);
+          const auto start = std::chrono::steady_clock::now();
+          try{
+            std::ofstream os(entry.out_file, std::ios::binary);
+            if(!os.good()) throw except::invalid_options("cannot write " + entry.out_file);
+            entry.result = convert(opts, entry.in_file, os, entry.out_file);
+          } catch(const std::exception& e){
+            entry.status = std::string("error: ") + e.what();
+          }
+          entry.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        });
+    }
+    pool.wait();
+  }
+
+  std::ofstream summary(opts.out_dir + "/summary.tsv");
+  summary << "input\toutput\tspecies\tcharacters\tvertices\tedges\tseconds\tstatus";
+  if(opts.bounds) summary << "\ttreewidth_lower\ttreewidth_upper\tfill_upper";
+  summary << std::endl;
+  int failures = 0;
+  for(const BatchEntry& entry: entries){
+    summary << entry.in_file << '\t' << entry.out_file << '\t' << entry.result.species << '\t' << entry.result.characters << '\t'
+            << entry.result.vertices << '\t' << entry.result.edges << '\t' << entry.seconds << '\t' << entry.status;
+    if(opts.bounds)
+      summary << '\t' << entry.result.bounds.lower_mmw << '\t' << entry.result.bounds.upper() << '\t' << entry.result.bounds.fill_upper();
+    summary << std::endl;
+    failures += (entry.status != "ok");
+  }
+  if(failures) std::cout << failures << " of "<<entries.size()<<" conversions failed, see "<<opts.out_dir<<"/summary.tsv"<<std::endl;
+  return failures ? 1 : 0;
+}
+
+// write the collected statistics to the given file ("-" = stderr, "" = nowhere)
+void write_stats(const std::string& stats_file)
+{
+  if(stats_file == "-")
+    stats::write_json(std::cerr);
+  else if(!stats_file.empty()){
+    std::ofstream os(stats_file);
+    stats::write_json(os);
+  }
+}
 
 int main(int argc, char* argv[])
 {
-  if((argc < 2) || (std::string(argv[1]) == "-h") || (std::string(argv[1]) == "--help") || (std::string(argv[1]) == "/?")){
-    std::cout << "syntax: "<<argv[0]<<" <file in fasta format> [output file]"<<std::endl;
+  Options opts;
+  try{
+    if(!parse_options(argc, argv, opts)){
+      print_usage(argv[0]);
+      return 1;
+    }
+  } catch(const except::invalid_options& e){
+    std::cout << e.what() << std::endl;
+    print_usage(argv[0]);
+    return 1;
+  } catch(const std::logic_error& e){
+    std::cout << "invalid number: " << e.what() << std::endl;
+    return 1;
+  }
+
+  int result = 0;
+  try{
+    if(!opts.batch.empty()) {
+      result = run_batch(opts);
+    } else if(!opts.subsample.empty()) {
+      write_sub_instances(opts);
+    } else if(opts.window) {
+      write_windows(opts);
+    } else {
+      std::ofstream out_file;
+      if(!opts.out_file.empty()) out_file.open(opts.out_file, std::ios::binary);
+      std::ostream& os = opts.out_file.empty() ? std::cout : out_file;
+
+      if(!opts.stats_file.empty()){
+        // record the up-front estimate, so it can be compared to the actual usage
+        const memory::Estimate estimate = estimate_memory(opts.in_file);
+        for(unsigned s = 0; s < memory::NUM_SUBSYSTEMS; ++s)
+          stats::set(std::string("estimated_bytes_") + memory::subsystem_name((memory::Subsystem)s), estimate.bytes[s]);
+        stats::set("estimated_peak_bytes", estimate.peak());
+      }
+      convert(opts, opts.in_file, os, opts.out_file);
+    }
+  } catch(const std::exception& e){
+    std::cout << "error: " << e.what() << std::endl;
     return 1;
-  } else {
-    Graph g;
-    DEBUG1(std::cout << "reading sequences..."<<std::endl);
-    SequenceMap *seq_map = new SequenceMap(argv[1]);
-    CharMatrix sequences(*seq_map);
-    delete seq_map;
-    sequences.IsolateSNIPs();
-
-    // for each character create vertices for each state
-    const auto size = sequences.size();
-    DEBUG3(std::cout << "read "<<size.first<<" species with "<<size.second<<" characters each"<<std::endl);
-    for(unsigned species = 0; species < size.first; ++species){
-      std::vector<Graph::Vertex> clique;
-      clique.reserve(size.second);
-      for(unsigned ch = 0; ch < size.second; ++ch)
-        if(sequences[{species, ch}])
-          clique.push_back(g.emplace_vertex_by_name(Graph::VertexName(ch, sequences[{species, ch}])));
-      DEBUG3(std::cout << "adding clique "<<species<<"/"<<size.first<<" containing "<<clique.size()<<" vertices"<<std::endl);
-      g.make_clique(clique);
-    }
-
-    if(argc > 2){
-      std::ofstream os(argv[2]);
-      io::write_edgelist(os, g);
-    } else io::write_edgelist(std::cout, g);
-
-    return 0;
   }
+  write_stats(opts.stats_file);
+  return result;
 }
@@ -0,0 +1,120 @@
+
+// merge overlapping sequences of a fasta file into contigs (see utils/overlap.hpp):
+// candidate pairs are found by k-mer sketches, their overlaps are scored by the (modified) Levenstein distance and
+// the best overlaps are merged greedily into consensus sequences
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include "utils/overlap.hpp"
+#include "utils/stats.hpp"
+#include "io/fasta.hpp"
+
+struct Options
+{
+  OverlapParams params;
+  std::string stats_file;      // write statistics as JSON to this file ("-" = stderr)
+  std::string in_file;
+  std::string out_file;
+};
+
+void print_usage(const char* name)
+{
+  std::cout << "syntax: "<<name<<" [options] <fasta file> [output file]"<<std::endl
+            << "  merges the overlapping sequences of the fasta file and writes the resulting contigs (to stdout by default)"<<std::endl
+            << "options:"<<std::endl
+            << "  --threads <k>       number of threads (default: 1)"<<std::endl
+            << "  --memory <MB>       memory budget of the overlap computations running at the same time"<<std::endl
+            << "  --kmer <k>          length of the k-mers used to find candidate pairs (default: 16)"<<std::endl
+            << "  --min-shared <m>    compare two sequences only if their sketches share m k-mers (default: 2)"<<std::endl
+            << "  --min-overlap <l>   minimum number of overlapping characters (default: 20)"<<std::endl
+            << "  --max-error <r>     maximum average distance per overlapping character (default: 0.05)"<<std::endl
+            << "  --hamming           score overlaps by Hamming distance instead of Levenstein distance"<<std::endl
+            << "  --stats <file>      write timings & counters as JSON to <file> (- for stderr)"<<std::endl;
+}
+
+// parse the command line into opts, return false if the program should not continue
+bool parse_options(int argc, char* argv[], Options& opts)
+{
+  std::vector<std::string> positional;
+  for(int i = 1; i < argc; ++i){
+    const std::string arg(argv[i]);
+    if((arg == "-h") || (arg == "--help") || (arg == "/?")) return false;
+    if(arg.substr(0, 2) == "--"){
+      if(arg == "--hamming"){
+        opts.params.hamming = true;
+        continue;
+      }
+      if(i + 1 == argc) throw except::invalid_options("missing argument to " + arg);
+      const std::string value(argv[++i]);
+      if(arg == "--threads"){
+        opts.params.threads = std::stoul(value);
+        if(!opts.params.threads) throw except::invalid_options("need at least one thread");
+      } else if(arg == "--memory") opts.params.memory_budget = std::stoul(value) << 20;
+      else if(arg == "--kmer"){
+        opts.params.k = std::stoul(value);
+        if(!opts.params.k) throw except::invalid_options("k-mers need at least one character");
+      } else if(arg == "--min-shared") opts.params.min_shared = std::max(1ul, std::stoul(value));
+      else if(arg == "--min-overlap") opts.params.min_overlap = std::stoul(value);
+      else if(arg == "--max-error") opts.params.max_error = std::stod(value);
+      else if(arg == "--stats") opts.stats_file = value;
+      else throw except::invalid_options("unknown option " + arg);
+    } else positional.push_back(arg);
+  }
+  if((positional.size() < 1) || (positional.size() > 2)) return false;
+  opts.in_file = positional[0];
+  if(positional.size() > 1) opts.out_file = positional[1];
+  return true;
+}
+
+// write the collected statistics to the given file ("-" = stderr, "" = nowhere)
+void write_stats(const std::string& stats_file)
+{
+  if(stats_file == "-")
+    stats::write_json(std::cerr);
+  else if(!stats_file.empty()){
+    std::ofstream os(stats_file);
+    stats::write_json(os);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  Options opts;
+  try{
+    if(!parse_options(argc, argv, opts)){
+      print_usage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  } catch(const except::invalid_options& e){
+    std::cout << e.what() << std::endl;
+    print_usage(argv[0]);
+    exit(EXIT_FAILURE);
+  } catch(const std::logic_error& e){
+    std::cout << "invalid number: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  SequenceMap sequences;
+  {
+    const stats::ScopedTimer timer("read_fasta");
+    io::read_fasta_file(opts.in_file, sequences);
+  }
+  stats::count("sequences", sequences.size());
+
+  SequenceMap contigs = merge_overlaps(sequences, opts.params);
+  stats::count("contigs", contigs.size());
+
+  {
+    const stats::ScopedTimer timer("write");
+    if(opts.out_file.empty())
+      io::write_sequence_map(std::cout, contigs);
+    else {
+      std::ofstream os(opts.out_file);
+      io::write_sequence_map(os, contigs);
+    }
+  }
+  write_stats(opts.stats_file);
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,83 @@
+
+// implementation of the in-memory library interface declared in pace.hpp
+
+#include <sstream>
+#include "pace.hpp"
+#include "utils/intersection_graph.hpp"
+#include "io/fasta.hpp"
+#include "io/edgelist.hpp"
+#include "io/csr.hpp"
+
+namespace pace {
+
+  const CharMatrix& InstanceBuilder::read_alignment(const char* data, const size_t length)
+  {
+    // NOTE: the order of the species depends on the bucket count of the arena's name index, so use a fresh one
+    //       each time to get the same instance as ma_to_cc
+    SequenceArena sequences;
+    io::read_fasta_buffer(data, length, sequences);
+    matrix.assign(sequences);
+    if(matrix.empty()) throw except::read_error(0, "no sequences in alignment");
+    matrix.IsolateSNIPs();
+    return matrix;
+  }
+
+  const CharMatrix& InstanceBuilder::read_alignment(const std::string& fasta)
+  {
+    return read_alignment(fasta.data(), fasta.length());
+  }
+
+  const Graph& InstanceBuilder::build_graph()
+  {
+    g.clear();
+    if(!matrix.empty()) add_species_cliques(matrix, g);
+    return g;
+  }
+
+  InstanceInfo InstanceBuilder::convert(const char* data, const size_t length)
+  {
+    read_alignment(data, length);
+    build_graph();
+    return info();
+  }
+
+  InstanceInfo InstanceBuilder::convert(const std::string& fasta)
+  {
+    return convert(fasta.data(), fasta.length());
+  }
+
+  void InstanceBuilder::cut(const size_t threshold)
+  {
+    g.truncate(threshold);
+  }
+
+  InstanceInfo InstanceBuilder::info() const
+  {
+    InstanceInfo result;
+    if(!matrix.empty()){
+      result.species = matrix.size().first;
+      result.characters = matrix.size().second;
+    }
+    result.vertices = g.num_vertices();
+    result.edges = g.num_edges();
+    return result;
+  }
+
+  void InstanceBuilder::write_edgelist(std::ostream& out) const
+  {
+    io::write_edgelist(out, g);
+  }
+
+  void InstanceBuilder::write_csr(std::ostream& out) const
+  {
+    io::write_csr(out, g);
+  }
+
+  std::string InstanceBuilder::edgelist() const
+  {
+    std::ostringstream out;
+    write_edgelist(out);
+    return out.str();
+  }
+
+}// namespace
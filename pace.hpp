@@ -0,0 +1,59 @@
+
+//! file pace.hpp
+/** The in-memory interface of the pace library:
+ * alignment buffer (fasta) -> CharMatrix -> character-state intersection graph -> cut/serialize
+ * without going through processes or files.
+ * An InstanceBuilder keeps its matrix and graph between conversions, so converting many small
+ * alignments in a row does not re-allocate them each time.
+ **/
+
+#pragma once
+
+#include <string>
+#include <iostream>
+#include "utils/sequences.hpp"
+#include "utils/graph.hpp"
+
+namespace pace {
+
+  // sizes of a converted instance
+  struct InstanceInfo
+  {
+    size_t species = 0;
+    size_t characters = 0;
+    size_t vertices = 0;
+    size_t edges = 0;
+  };
+
+  class InstanceBuilder
+  {
+  protected:
+    CharMatrix matrix;
+    Graph g;
+
+  public:
+    //! parse an alignment in fasta format and reduce it to its informative characters
+    const CharMatrix& read_alignment(const char* data, const size_t length);
+    const CharMatrix& read_alignment(const std::string& fasta);
+
+    //! build the character-state intersection graph of the last alignment read
+    const Graph& build_graph();
+
+    //! read_alignment() followed by build_graph()
+    InstanceInfo convert(const char* data, const size_t length);
+    InstanceInfo convert(const std::string& fasta);
+
+    //! restrict the graph to the vertices of index < threshold
+    void cut(const size_t threshold);
+
+    InstanceInfo info() const;
+    const CharMatrix& char_matrix() const { return matrix; }
+    const Graph& graph() const { return g; }
+
+    void write_edgelist(std::ostream& out) const;
+    void write_csr(std::ostream& out) const;
+    //! return the graph as edge list
+    std::string edgelist() const;
+  };
+
+}// namespace
@@ -0,0 +1,37 @@
+#!/bin/sh
+# regression test for the instance cache of ma_to_cc: all orders of the records of one alignment have to give one and
+# the same instance, with and without --cache (the species are put into canonical order before the conversion)
+# usage: cache_species_order.sh <ma_to_cc>
+
+MA_TO_CC="$1"
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+# the first record has a gap, so if the species were taken in file order, which record comes first would decide which
+# characters IsolateSNIPs() keeps
+set -- ">s0
+-ACGTA" ">s1
+AACGTT" ">s2
+CAGGTA" ">s3
+GACCTA"
+i=0
+for a in 1 2 3 4; do for b in 1 2 3 4; do for c in 1 2 3 4; do for d in 1 2 3 4; do
+  [ $a = $b ] || [ $a = $c ] || [ $a = $d ] || [ $b = $c ] || [ $b = $d ] || [ $c = $d ] && continue
+  eval "printf '%s\n%s\n%s\n%s\n' \"\${$a}\" \"\${$b}\" \"\${$c}\" \"\${$d}\"" > "$DIR/p$i.fa"
+  i=$((i + 1))
+done; done; done; done
+
+status=0
+for f in "$DIR"/p*.fa; do
+  "$MA_TO_CC" "$f" "$f.fresh" > /dev/null || exit 1
+  "$MA_TO_CC" --cache "$DIR/cache" "$f" "$f.cached" > /dev/null || exit 1
+  if ! cmp -s "$f.fresh" "$f.cached"; then
+    echo "$(basename "$f"): cached instance differs from a fresh conversion"
+    status=1
+  fi
+  if ! cmp -s "$f.fresh" "$DIR/p0.fa.fresh"; then
+    echo "$(basename "$f"): instance differs from the one of p0.fa"
+    status=1
+  fi
+done
+exit $status
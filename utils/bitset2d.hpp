@@ -8,15 +8,16 @@
 #pragma once
 
 #include <cassert>
+#include <algorithm>
 #include "vector2d.hpp"
 #include <boost/dynamic_bitset.hpp>
 
 namespace std{
-  template<typename Symmetry = Asymmetric>
-  class bitset2d : public Something2d<bool, boost::dynamic_bitset<unsigned>, Symmetry>
+  template<typename Symmetry = Asymmetric, typename Alloc = allocator<unsigned>>
+  class bitset2d : public Something2d<bool, boost::dynamic_bitset<unsigned, Alloc>, Symmetry>
   {
   protected:
-    using Parent = Something2d<bool, boost::dynamic_bitset<unsigned>, Symmetry>;
+    using Parent = Something2d<bool, boost::dynamic_bitset<unsigned, Alloc>, Symmetry>;
     using GrandPa = typename Parent::Parent;
     using Coords = typename Parent::Coords;
 
@@ -45,6 +46,142 @@ namespace std{
     {
       return GrandPa::count();
     }
+    //! reset (col, row) for all col in [from, to) at once
+    /** NOTE: requires (from,row),...,(to-1,row) to be consecutive in memory, which for symmetric bitsets means to <= row + 1 **/
+    bitset2d& reset_range(const size_t row, const size_t from, const size_t to)
+    {
+      if(from < to) GrandPa::reset(Parent::linearize({from, row}), to - from);
+      return *this;
+    }
+
+    //! call f(coords) for each set bit of the rows [0, end_row) in order of their linear index
+    /** this scans whole words instead of testing bits one by one;
+     * for symmetric bitsets, only coordinates (col, row) with col <= row are reported
+     **/
+    template<typename Function>
+    void for_each_set(Function f, size_t end_row = -1) const
+    {
+      const size_t num_rows = GrandPa::empty() ? 0 : Parent::size().second;
+      end_row = std::min(end_row, num_rows);
+      const size_t end = std::min(Parent::linearize({0, end_row}), GrandPa::size());
+      size_t row = 0;
+      size_t row_start = 0;
+      size_t next_row_start = Parent::linearize({0, 1});
+      for(size_t pos = GrandPa::find_first(); pos < end; pos = GrandPa::find_next(pos)){
+        while(pos >= next_row_start){
+          row_start = next_row_start;
+          next_row_start = Parent::linearize({0, ++row + 1});
+        }
+        f(Coords(pos - row_start, row));
+      }
+    }
+
+    //! return the (symmetric) submatrix of the rows & columns i with keep[i] set, renumbered consecutively
+    /** the kept columns of each kept row form a few runs of consecutive bits, both here and in the result, so
+     * each run is copied word by word while the blocks of this bitset are streamed once; this is fast if the
+     * runs of keep are long, for scattered masks, copying the set bits one by one is faster
+     **/
+    template<typename Mask, typename Q = Symmetry>
+    typename enable_if<is_same<Q, Symmetric>::value, bitset2d>::type
+    principal_submatrix(const Mask& keep) const
+    {
+      assert(keep.size() == Parent::cols());
+      // the runs [first, end) of consecutive kept rows/columns
+      std::vector<Coords> runs;
+      for(size_t first = keep.find_first(); first != Mask::npos;){
+        size_t end = first + 1;
+        while((end < keep.size()) && keep.test(end)) ++end;
+        runs.emplace_back(first, end);
+        first = (end < keep.size()) ? keep.find_next(end) : Mask::npos;
+      }
+      bitset2d result;
+      if(runs.empty()) return result;
+
+      struct Extractor
+      {
+        typedef typename GrandPa::block_type Block;
+        const size_t bits = GrandPa::bits_per_block;
+
+        const bitset2d& source;
+        const Mask& keep;
+        const std::vector<Coords>& runs;
+        GrandPa& target;
+        size_t row, run = 0;           // the current segment is the part of runs[run] in row
+        size_t seg_start = 0, seg_len = 0;
+        size_t block_start = 0;        // linear index of the first bit of the next block
+        Block pending = 0;             // the bits of target that are not appended yet
+        size_t num_pending = 0;
+
+        Extractor(const bitset2d& _source, const Mask& _keep, const std::vector<Coords>& _runs, GrandPa& _target):
+          source(_source), keep(_keep), runs(_runs), target(_target), row(_keep.find_first())
+        {
+          next_segment();
+        }
+
+        // advance to the next run of kept columns of a kept row, or set seg_len to 0 if there is none
+        void next_segment()
+        {
+          while(row != Mask::npos){
+            if((run < runs.size()) && (runs[run].first <= row)){
+              seg_start = source.linearize({runs[run].first, row});
+              seg_len = std::min(runs[run].second, row + 1) - runs[run].first;
+              ++run;
+              return;
+            }
+            row = keep.find_next(row);
+            run = 0;
+          }
+          seg_len = 0;
+        }
+
+        // append the lowest n bits of b to the target
+        void push(const Block b, const size_t n)
+        {
+          pending |= b << num_pending;
+          if(num_pending + n >= bits){
+            target.append(pending);
+            pending = num_pending ? (Block)(b >> (bits - num_pending)) : 0;
+            num_pending = num_pending + n - bits;
+          } else num_pending += n;
+        }
+
+        // consume the next block of the source
+        void operator()(const Block block)
+        {
+          const size_t block_end = block_start + bits;
+          while(seg_len && (seg_start < block_end)){
+            const size_t offset = seg_start - block_start;
+            const size_t n = std::min(seg_len, block_end - seg_start);
+            const Block mask = (n == bits) ? ~(Block)0 : (Block)(((Block)1 << n) - 1);
+            push((block >> offset) & mask, n);
+            seg_start += n;
+            seg_len -= n;
+            if(!seg_len) next_segment();
+          }
+          block_start = block_end;
+        }
+      };
+
+      // an output iterator feeding the blocks to the extractor, as expected by boost::to_block_range()
+      struct BlockSink
+      {
+        Extractor* extractor;
+        BlockSink& operator*() { return *this; }
+        BlockSink& operator++() { return *this; }
+        BlockSink operator++(int) { return *this; }
+        BlockSink& operator=(const typename Extractor::Block block) { (*extractor)(block); return *this; }
+      };
+
+      GrandPa compacted;
+      Extractor extractor(*this, keep, runs, compacted);
+      boost::to_block_range(*this, BlockSink{&extractor});
+      if(extractor.num_pending) compacted.append(extractor.pending);
+      const size_t k = keep.count();
+      compacted.resize(k * (k + 1) / 2);
+      static_cast<GrandPa&>(result).swap(compacted);
+      result.resize(k, k);
+      return result;
+    }
   };
   typedef bitset2d<Symmetric> symmetric_bitset2d;
 
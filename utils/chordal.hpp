@@ -0,0 +1,143 @@
+
+//! file chordal.hpp
+/** Recognition of chordal graphs:
+ * Maximum Cardinality Search computes an ordering that is a perfect elimination ordering (PEO) iff the graph is chordal.
+ * The ordering is verified with one subset check per vertex on bitset rows: the later neighbors of each vertex v,
+ * except its parent p (the earliest of them), have to be neighbors of p. If the check fails for v, then p and
+ * some later neighbor w of v are not adjacent and a shortest path from p to w avoiding the other neighbors of v
+ * closes a chordless cycle with v.
+ * MCS runs in O(n + m), the verification in O(n^2 / wordsize).
+ **/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "utils/utils.hpp"
+#include "utils/graph.hpp"
+
+struct ChordalityResult
+{
+  bool chordal;
+  std::vector<Graph::Vertex> peo;   // if chordal: a perfect elimination ordering
+  std::vector<Graph::Vertex> cycle; // if not chordal: the vertices of a chordless cycle of length >= 4, in order
+};
+
+//! return the reverse of the order in which Maximum Cardinality Search visits the vertices
+/** this is a PEO iff the graph is chordal **/
+inline std::vector<Graph::Vertex> mcs_ordering(const Graph::AdjacencyLists& adj)
+{
+  const size_t n = adj.size();
+  std::vector<Graph::Vertex> result(n);
+  std::vector<size_t> weight(n, 0);
+  std::vector<bool> visited(n, false);
+  // buckets[w] contains the vertices of weight w (and outdated entries of vertices that have been visited or re-weighted)
+  std::vector<std::vector<Graph::Vertex>> buckets(n + 1);
+  for(size_t v = n; v-- > 0;) buckets[0].push_back(v);
+  size_t max_weight = 0;
+  for(size_t i = n; i-- > 0;){
+    Graph::Vertex v;
+    while(true){
+      while(buckets[max_weight].empty()) --max_weight;
+      v = buckets[max_weight].back();
+      buckets[max_weight].pop_back();
+      if(!visited[v] && (weight[v] == max_weight)) break;
+    }
+    visited[v] = true;
+    result[i] = v;
+    for(const Graph::Vertex u: adj[v])
+      if(!visited[u]){
+        buckets[++weight[u]].push_back(u);
+        max_weight = std::max(max_weight, weight[u]);
+      }
+  }
+  return result;
+}
+
+//! return a shortest path from s to t using only vertices in allowed (s and t have to be allowed), or an empty path
+inline std::vector<Graph::Vertex> shortest_path(const Graph::AdjacencyLists& adj, const Graph::Vertex s, const Graph::Vertex t, const Graph::VertexSet& allowed)
+{
+  const Graph::Vertex none = -1;
+  std::vector<Graph::Vertex> pred(adj.size(), none);
+  std::deque<Graph::Vertex> queue(1, s);
+  pred[s] = s;
+  while(!queue.empty() && (pred[t] == none)){
+    const Graph::Vertex v = queue.front();
+    queue.pop_front();
+    for(const Graph::Vertex u: adj[v])
+      if(allowed.test(u) && (pred[u] == none)){
+        pred[u] = v;
+        queue.push_back(u);
+      }
+  }
+  std::vector<Graph::Vertex> path;
+  if(pred[t] == none) return path;
+  for(Graph::Vertex v = t; v != s; v = pred[v]) path.push_back(v);
+  path.push_back(s);
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+//! decide whether g is chordal, returning a PEO or a chordless cycle as certificate
+inline ChordalityResult recognize_chordal(const Graph& g)
+{
+  typedef Graph::Vertex Vertex;
+  typedef Graph::VertexSet VertexSet;
+  const size_t n = g.num_vertices();
+  const Graph::AdjacencyLists adj = g.adjacency_lists();
+
+  ChordalityResult result;
+  result.peo = mcs_ordering(adj);
+  std::vector<size_t> position(n);
+  for(size_t i = 0; i < n; ++i) position[result.peo[i]] = i;
+
+  // the neighborhoods, indexed by & containing positions in the PEO, so the later neighbors of a vertex are its higher bits
+  std::vector<VertexSet> rows(n, VertexSet(n));
+  g.for_each_edge([&](const Vertex u, const Vertex v){
+      rows[position[u]].set(position[v]);
+      rows[position[v]].set(position[u]);
+    });
+
+  VertexSet later;
+  for(size_t i = 0; i < n; ++i){
+    const size_t parent = rows[i].find_next(i);
+    if(parent == VertexSet::npos) continue;
+    later = rows[i];
+    later.reset(0, parent + 1);
+    if(later.is_subset_of(rows[parent])) continue;
+
+    // later neighbors of i that are not adjacent to the parent; any of them closes a chordless cycle
+    later -= rows[parent];
+    const Vertex v = result.peo[i];
+    const Vertex p = result.peo[parent];
+    const Vertex w = result.peo[later.find_first()];
+    DEBUG2(std::cout << "PEO violated at "<<v<<": neighbors "<<p<<" and "<<w<<" are not adjacent"<<std::endl);
+    // a shortest p-w path avoiding v and its other neighbors is induced and only its ends are adjacent to v;
+    // prefer the vertices after v in the ordering, but fall back to the whole graph
+    VertexSet allowed(n);
+    for(size_t j = i + 1; j < n; ++j) allowed.set(result.peo[j]);
+    for(size_t u = rows[i].find_first(); u != VertexSet::npos; u = rows[i].find_next(u)) allowed.reset(result.peo[u]);
+    allowed.set(p);
+    allowed.set(w);
+    std::vector<Vertex> path = shortest_path(adj, p, w, allowed);
+    if(path.empty()){
+      allowed.set();
+      for(size_t u = rows[i].find_first(); u != VertexSet::npos; u = rows[i].find_next(u)) allowed.reset(result.peo[u]);
+      allowed.reset(v);
+      allowed.set(p);
+      allowed.set(w);
+      path = shortest_path(adj, p, w, allowed);
+    }
+    result.chordal = false;
+    result.peo.clear();
+    if(!path.empty()){
+      result.cycle.push_back(v);
+      result.cycle.insert(result.cycle.end(), path.begin(), path.end());
+    }
+    return result;
+  }
+  result.chordal = true;
+  return result;
+}
+
@@ -0,0 +1,63 @@
+
+//! file cut_profile.hpp
+/** The instance-size profile of a graph with respect to prefix cuts:
+ * for each threshold t, the number of edges and non-isolated vertices of the subgraph induced by {0, ..., t-1}.
+ * An edge uv appears in all cuts with t > max(u,v) and a vertex appears as soon as its first edge does,
+ * so one pass over the edges, histograms over these "activation thresholds" and prefix sums give the whole profile.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "utils/utils.hpp"
+
+struct CutProfile
+{
+  // num_edges[t] & num_vertices[t] are the number of edges & non-isolated vertices of the cut at threshold t
+  std::vector<size_t> num_edges;
+  std::vector<size_t> num_vertices;
+
+  template<typename Graph>
+  CutProfile(const Graph& g):
+    num_edges(g.num_vertices() + 1, 0),
+    num_vertices(g.num_vertices() + 1, 0)
+  {
+    const size_t n = g.num_vertices();
+    // activation[x] = smallest threshold t such that x is not isolated in the cut at t (or n+1 if x is isolated in g)
+    std::vector<size_t> activation(n, n + 1);
+    g.for_each_edge([&](const size_t u, const size_t v){
+        ++num_edges[u + 1];
+        activation[u] = std::min(activation[u], u + 1);
+        activation[v] = std::min(activation[v], u + 1);
+      });
+    for(const size_t t: activation) if(t <= n) ++num_vertices[t];
+    for(size_t t = 1; t <= n; ++t){
+      num_edges[t] += num_edges[t - 1];
+      num_vertices[t] += num_vertices[t - 1];
+    }
+  }
+
+  size_t max_threshold() const
+  {
+    return num_edges.size() - 1;
+  }
+
+  //! return the largest threshold whose cut has at most max_edges edges and at most max_vertices non-isolated vertices
+  size_t find_threshold(const size_t max_edges = -1, const size_t max_vertices = -1) const
+  {
+    // both sequences are non-decreasing, so we can binary search for the first threshold exceeding the budget
+    const size_t by_edges = std::upper_bound(num_edges.begin(), num_edges.end(), max_edges) - num_edges.begin();
+    const size_t by_vertices = std::upper_bound(num_vertices.begin(), num_vertices.end(), max_vertices) - num_vertices.begin();
+    return std::min(by_edges, by_vertices) - 1;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const CutProfile& p)
+  {
+    os << "# threshold edges vertices"<<std::endl;
+    for(size_t t = 0; t <= p.max_threshold(); ++t)
+      os << t << " " << p.num_edges[t] << " " << p.num_vertices[t] << '\n';
+    return os;
+  }
+};
+
@@ -0,0 +1,63 @@
+
+//! file distances.hpp
+/** Hamming distances between all pairs of species of a character matrix, for clustering the species and for
+ * spotting near-duplicate sequences:
+ * the matrix is stored character by character, so the species (columns of the matrix) are first copied into
+ * contiguous rows, each starting on a cache line.
+ * The pairs are then computed in tiles of DISTANCE_TILE_SPECIES x DISTANCE_TILE_SPECIES species, in chunks of
+ * DISTANCE_TILE_CHARACTERS characters, so the rows of both tiles stay in the cache while they are compared.
+ * The tiles are distributed over a thread pool; each tile writes its own entries of the result.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "utils/utils.hpp"
+#include "utils/vector2d.hpp"
+#include "utils/sequences.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/thread_pool.hpp"
+
+// number of species per tile & characters per chunk (2 tiles of 32 rows of 4K characters = 256K fit into L2)
+#define DISTANCE_TILE_SPECIES 32
+#define DISTANCE_TILE_CHARACTERS 4096
+
+//! return the Hamming distance between each pair of species of the matrix (species x species, 0 on the diagonal)
+/** NOTE: characters removed by IsolateSNIPs() count as equal in all species **/
+inline std::symmetric_vector2d<unsigned> species_distances(const CharMatrix& matrix, const unsigned threads = 1)
+{
+  const size_t n = matrix.empty() ? 0 : matrix.size().first;
+  const size_t m = matrix.empty() ? 0 : matrix.size().second;
+  if(n == 0) return std::symmetric_vector2d<unsigned>();
+  std::symmetric_vector2d<unsigned> result(n, n, 0);
+
+  // rows.row(s) = the states of species s, padded to a multiple of 64 characters
+  std::aligned_vector2d<char> rows(m, n, 0, 64);
+  for(size_t s = 0; s < n; ++s){
+    const auto species = matrix.column(s);
+    std::copy(species.begin(), species.end(), rows.row(s).data());
+  }
+
+  // pairs (a, b) of tiles with a <= b
+  const size_t num_tiles = (n + DISTANCE_TILE_SPECIES - 1) / DISTANCE_TILE_SPECIES;
+  std::vector<std::pair<size_t, size_t>> tiles;
+  for(size_t b = 0; b < num_tiles; ++b)
+    for(size_t a = 0; a <= b; ++a) tiles.emplace_back(a, b);
+
+  ThreadPool pool(threads);
+  pool.parallel_for(tiles.size(), [&](const size_t t){
+      const size_t first_i = tiles[t].first * DISTANCE_TILE_SPECIES;
+      const size_t end_i = std::min(n, first_i + DISTANCE_TILE_SPECIES);
+      const size_t first_j = tiles[t].second * DISTANCE_TILE_SPECIES;
+      const size_t end_j = std::min(n, first_j + DISTANCE_TILE_SPECIES);
+      for(size_t k = 0; k < m; k += DISTANCE_TILE_CHARACTERS){
+        const unsigned length = std::min<size_t>(DISTANCE_TILE_CHARACTERS, m - k);
+        for(size_t i = first_i; i < end_i; ++i)
+          for(size_t j = std::max(first_j, i + 1); j < end_j; ++j)
+            result[{i, j}] += hamming_distance(rows.row(i).data() + k, rows.row(j).data() + k, length);
+      }
+    });
+  return result;
+}
+
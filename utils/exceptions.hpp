@@ -9,6 +9,7 @@
 
 #include <string>
 #include <exception>
+#include <stdexcept>
 #include "utils/utils.hpp"
 
 namespace except {
@@ -57,6 +58,11 @@ namespace except {
     using read_error::read_error;
   };
 
+  //! an exception for the case that a (temporary) file could not be created, written or read back at run time
+  struct io_error: public std::runtime_error {
+    using std::runtime_error::runtime_error;
+  };
+
 }// namespace
 
 #endif
@@ -0,0 +1,315 @@
+
+//! file external_edges.hpp
+/** An out-of-core edge collection for graphs whose adjacency matrix does not fit into memory.
+ * Edges are collected into a bounded in-memory run; full runs are sorted, de-duplicated and
+ * spilled to temporary files. As soon as EXTERNAL_MERGE_FANIN runs of the same level exist, they are merged into
+ * one run of the next level, so the number of open run files grows only logarithmically with the number of runs.
+ * In the end, a k-way merge of at most EXTERNAL_MERGE_FANIN runs streams all distinct edges in sorted order.
+ * Edges are stored as (larger index, smaller index), so the merge produces them in the same order
+ * as io::write_edgelist() does for a Graph.
+ **/
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <unistd.h>
+#include <boost/unordered_map.hpp>
+
+#include "utils/utils.hpp"
+#include "utils/exceptions.hpp"
+#include "utils/memory.hpp"
+
+// minimum number of edges buffered for each run during the merge
+#define EXTERNAL_MIN_MERGE_BUFFER 1024
+// maximum number of runs merged at the same time
+#define EXTERNAL_MERGE_FANIN 16
+
+class ExternalEdgeSorter
+{
+public:
+  typedef std::pair<uint32_t, uint32_t> Edge;
+  typedef std::vector<Edge, memory::TrackingAllocator<Edge, memory::ADJACENCY>> EdgeBuffer;
+
+protected:
+  // a spilled run: a temporary file containing a sorted list of distinct edges;
+  // runs of level l > 0 are the result of merging EXTERNAL_MERGE_FANIN runs of level l - 1
+  struct Run
+  {
+    FILE* file;
+    size_t size;
+    unsigned level;
+  };
+
+  // a cursor into a run during the k-way merge
+  struct RunCursor
+  {
+    FILE* file;
+    size_t remaining;
+    EdgeBuffer buffer;
+    size_t pos = 0;
+
+    RunCursor(const Run& r, const size_t buffer_size):
+      file(r.file), remaining(r.size)
+    {
+      buffer.reserve(buffer_size);
+      std::rewind(file);
+      refill(buffer_size);
+    }
+
+    bool refill(const size_t buffer_size)
+    {
+      const size_t to_read = std::min(remaining, buffer_size);
+      buffer.resize(to_read);
+      pos = 0;
+      if(to_read && (std::fread(buffer.data(), sizeof(Edge), to_read, file) != to_read))
+        throw except::io_error("could not read back spilled edge run");
+      remaining -= to_read;
+      return to_read != 0;
+    }
+
+    bool empty() const { return pos == buffer.size(); }
+    const Edge& front() const { return buffer[pos]; }
+  };
+
+  const size_t memory_budget;
+  const std::string tmp_dir;
+  const size_t run_capacity;
+  EdgeBuffer current_run;
+  std::vector<Run> runs;       // the levels of the runs never increase from front to back
+  size_t spilled = 0;
+
+  FILE* open_tmp_file() const
+  {
+    if(tmp_dir.empty()){
+      FILE* f = std::tmpfile();
+      if(!f) throw except::io_error("could not create a temporary file");
+      return f;
+    } else {
+      std::string name_template = tmp_dir + "/pace_runXXXXXX";
+      const int fd = mkstemp(&name_template[0]);
+      if(fd < 0) throw except::io_error("could not create a temporary file in " + tmp_dir);
+      // unlink right away so the file disappears when it is closed (or we crash)
+      unlink(name_template.c_str());
+      FILE* f = fdopen(fd, "w+b");
+      if(!f){
+        close(fd);
+        throw except::io_error("could not open a temporary file in " + tmp_dir);
+      }
+      return f;
+    }
+  }
+
+  static void write_edges(FILE* f, const EdgeBuffer& edges)
+  {
+    if(std::fwrite(edges.data(), sizeof(Edge), edges.size(), f) != edges.size())
+      throw except::io_error("could not write edge run to temporary file (disk full?)");
+  }
+
+  static void finish_run(FILE* f)
+  {
+    if(std::fflush(f)) throw except::io_error("could not write edge run to temporary file (disk full?)");
+  }
+
+  // sort and de-duplicate the current run
+  void normalize_run()
+  {
+    std::sort(current_run.begin(), current_run.end());
+    current_run.erase(std::unique(current_run.begin(), current_run.end()), current_run.end());
+  }
+
+  //! call f(edge) for each distinct edge of the runs from index 'first' on in increasing order, then drop these runs
+  template<typename Function>
+  void merge_runs(const size_t first, const size_t buffer_size, Function f)
+  {
+    std::vector<RunCursor> cursors;
+    cursors.reserve(runs.size() - first);
+    for(size_t r = first; r < runs.size(); ++r) cursors.emplace_back(runs[r], buffer_size);
+
+    // min-heap of (edge, cursor index)
+    typedef std::pair<Edge, unsigned> HeapEntry;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    for(unsigned i = 0; i < cursors.size(); ++i)
+      if(!cursors[i].empty()) heap.emplace(cursors[i].front(), i);
+
+    bool first_edge = true;
+    Edge last;
+    while(!heap.empty()){
+      const HeapEntry top = heap.top();
+      heap.pop();
+      if(first_edge || (top.first != last)){
+        f(top.first);
+        last = top.first;
+        first_edge = false;
+      }
+      RunCursor& c = cursors[top.second];
+      ++c.pos;
+      if(!c.empty() || c.refill(buffer_size)) heap.emplace(c.front(), top.second);
+    }
+    for(size_t r = first; r < runs.size(); ++r) std::fclose(runs[r].file);
+    runs.resize(first);
+  }
+
+  // merge the last EXTERNAL_MERGE_FANIN runs into one run of the given level
+  void merge_last_runs(const unsigned level)
+  {
+    const size_t first = runs.size() - EXTERNAL_MERGE_FANIN;
+    DEBUG3(std::cout << "merging runs #"<<first<<" to #"<<runs.size() - 1<<" into a run of level "<<level<<std::endl);
+    Run merged{open_tmp_file(), 0, level};
+    try{
+      EdgeBuffer out;
+      out.reserve(EXTERNAL_MIN_MERGE_BUFFER);
+      merge_runs(first, EXTERNAL_MIN_MERGE_BUFFER, [&](const Edge& e){
+          out.push_back(e);
+          if(out.size() == EXTERNAL_MIN_MERGE_BUFFER){
+            write_edges(merged.file, out);
+            merged.size += out.size();
+            out.clear();
+          }
+        });
+      write_edges(merged.file, out);
+      merged.size += out.size();
+      finish_run(merged.file);
+    } catch(...) {
+      std::fclose(merged.file);
+      throw;
+    }
+    runs.push_back(merged);
+  }
+
+  void spill()
+  {
+    normalize_run();
+    if(current_run.empty()) return;
+    DEBUG3(std::cout << "spilling run #"<<spilled<<" of "<<current_run.size()<<" edges"<<std::endl);
+    FILE* f = open_tmp_file();
+    try{
+      write_edges(f, current_run);
+      finish_run(f);
+    } catch(...) {
+      std::fclose(f);
+      throw;
+    }
+    runs.push_back({f, current_run.size(), 0});
+    ++spilled;
+    current_run.clear();
+    // since the levels do not increase, the last EXTERNAL_MERGE_FANIN runs have the same level if the first of them does
+    while((runs.size() >= EXTERNAL_MERGE_FANIN) && (runs[runs.size() - EXTERNAL_MERGE_FANIN].level == runs.back().level))
+      merge_last_runs(runs.back().level + 1);
+  }
+
+public:
+
+  // memory_budget is the number of bytes that may be used to buffer edges
+  ExternalEdgeSorter(const size_t _memory_budget, const std::string& _tmp_dir = ""):
+    memory_budget(_memory_budget),
+    tmp_dir(_tmp_dir),
+    run_capacity(std::max<size_t>(_memory_budget / sizeof(Edge), EXTERNAL_MIN_MERGE_BUFFER))
+  {
+    current_run.reserve(run_capacity);
+  }
+
+  ~ExternalEdgeSorter()
+  {
+    for(const Run& r: runs) std::fclose(r.file);
+  }
+
+  //! the number of runs spilled to disk so far
+  size_t num_runs() const
+  {
+    return spilled;
+  }
+
+  void add_edge(const uint32_t u, const uint32_t v)
+  {
+    if(u == v) return;
+    if(current_run.size() == run_capacity) {
+      // try to make room in memory before spilling a run to disk
+      normalize_run();
+      if(current_run.size() > run_capacity / 2) spill();
+    }
+    current_run.emplace_back(std::max(u, v), std::min(u, v));
+  }
+
+  //! call f(larger, smaller) for each distinct edge in increasing order
+  /** NOTE: this consumes the stored edges */
+  template<typename Function>
+  void merge(Function f)
+  {
+    normalize_run();
+    if(runs.empty()){
+      for(const Edge& e: current_run) f(e.first, e.second);
+    } else {
+      spill();
+      EdgeBuffer().swap(current_run);
+
+      // merge the small runs in the back until the remaining runs can be merged at once
+      while(runs.size() > EXTERNAL_MERGE_FANIN) merge_last_runs(runs.back().level);
+
+      const size_t buffer_size = std::max<size_t>(memory_budget / (sizeof(Edge) * runs.size()), EXTERNAL_MIN_MERGE_BUFFER);
+      DEBUG3(std::cout << "merging "<<runs.size()<<" runs with "<<buffer_size<<" edges buffer each"<<std::endl);
+      merge_runs(0, buffer_size, [&f](const Edge& e){ f(e.first, e.second); });
+    }
+    current_run.clear();
+  }
+};
+
+
+// a graph that knows its vertex names, but stores its edges out-of-core
+class ExternalEdgeGraph
+{
+public:
+  typedef uint32_t Vertex;
+  typedef std::pair<uint32_t, char> VertexName;
+
+protected:
+  boost::unordered_map<VertexName, Vertex, boost::hash<VertexName>, std::equal_to<VertexName>,
+                       memory::TrackingAllocator<std::pair<const VertexName, Vertex>, memory::VERTEX_NAMES>> name_to_vertex;
+  ExternalEdgeSorter edges;
+
+public:
+  ExternalEdgeGraph(const size_t memory_budget, const std::string& tmp_dir = ""):
+    edges(memory_budget, tmp_dir)
+  {}
+
+  size_t num_vertices() const
+  {
+    return name_to_vertex.size();
+  }
+
+  size_t num_runs() const
+  {
+    return edges.num_runs();
+  }
+
+  // return the vertex with the specified name or create one if the name does not exist
+  Vertex emplace_vertex_by_name(const VertexName& vname)
+  {
+    return name_to_vertex.emplace(vname, name_to_vertex.size()).first->second;
+  }
+
+  void add_edge(const Vertex u, const Vertex v)
+  {
+    edges.add_edge(u, v);
+  }
+
+  template<typename Container = std::vector<Vertex>>
+  void make_clique(const Container& clique)
+  {
+    for(auto u_iter = clique.begin(); u_iter != clique.end(); ++u_iter)
+      for(auto v_iter = std::next(u_iter); v_iter != clique.end(); ++v_iter)
+        add_edge(*u_iter, *v_iter);
+  }
+
+  //! call f(larger, smaller) for each edge in increasing order; this consumes the edges
+  template<typename Function>
+  void merge_edges(Function f)
+  {
+    edges.merge(f);
+  }
+};
+
@@ -1,10 +1,16 @@
 
 #pragma once
 
+#include <vector>
 #include <boost/unordered_map.hpp>
+#include <boost/dynamic_bitset.hpp>
 #include "utils/bitset2d.hpp"
+#include "utils/memory.hpp"
 
-typedef std::symmetric_bitset2d AdjMatrix;
+typedef std::bitset2d<std::Symmetric, memory::TrackingAllocator<unsigned, memory::ADJACENCY>> AdjMatrix;
+
+// induced_subgraph() copies the adjacency rows word by word if the kept vertices form runs of at least this length on average
+#define GRAPH_WORDWISE_MIN_RUN 64
 
 class Counter
 {
@@ -70,12 +76,31 @@ public:
   typedef Counter VertexIter;
   typedef std::pair<VertexIter, VertexIter> VertexIterRange;
   typedef AdjMatrixIter AdjIter;
+  typedef boost::dynamic_bitset<> VertexSet;
+  typedef std::vector<std::vector<Vertex>> AdjacencyLists;
+  typedef boost::unordered_map<VertexName, Vertex, boost::hash<VertexName>, std::equal_to<VertexName>,
+                               memory::TrackingAllocator<std::pair<const VertexName, Vertex>, memory::VERTEX_NAMES>> NameMap;
 
 protected:
-  boost::unordered_map<VertexName, Vertex> name_to_vertex;
+  NameMap name_to_vertex;
   AdjMatrix adj;
 public:
 
+  Graph() {}
+
+  //! create a graph with n vertices and no edges, allocating the adjacency matrix at once
+  Graph(const size_t n)
+  {
+    if(n) adj.resize(n, n);
+  }
+
+  //! remove all vertices & edges, keeping the allocated memory for later use
+  void clear()
+  {
+    name_to_vertex.clear();
+    adj.clear();
+  }
+
   size_t num_vertices() const
   {
     return adj.cols();
@@ -86,6 +111,14 @@ public:
     return adj.count();
   }
 
+  //! return the name of each vertex (vertices without name are named (-1, 0))
+  std::vector<VertexName> vertex_names() const
+  {
+    std::vector<VertexName> result(num_vertices(), VertexName(-1, 0));
+    for(const auto& n2v: name_to_vertex) result[n2v.second] = n2v.first;
+    return result;
+  }
+
   unsigned get_index(const Vertex& u) const
   {
     return u;
@@ -108,6 +141,14 @@ public:
       return n2v_iter->second;
   }
 
+  //! give the vertex v the name vname, which must not be in use yet
+  void set_name(const Vertex v, const VertexName& vname)
+  {
+    const bool inserted = name_to_vertex.emplace(vname, v).second;
+    assert(inserted);
+    (void)inserted;
+  }
+
   void add_edge(const Vertex u, const Vertex v)
   {
     adj.set({u,v});
@@ -131,10 +172,136 @@ public:
     return AdjIterRange(adj, v);
   }
 
+  //! call f(u, v) for each edge uv with v < u < vertex_bound, in increasing order of (u, v)
+  /** this is the order in which io::write_edgelist() lists the edges;
+   * using a vertex_bound t gives exactly the edges of the subgraph induced by the vertices 0, ..., t-1
+   **/
+  template<typename Function>
+  void for_each_edge(Function f, const size_t vertex_bound = -1) const
+  {
+    adj.for_each_set([&f](const std::pair<size_t, size_t>& coords){
+        if(coords.first != coords.second) f(coords.second, coords.first);
+      }, vertex_bound);
+  }
+
   void isolate_vertex(const Vertex& u)
   {
-    unsigned v = adj.cols() - 1;
-    do adj.reset({u,v}); while(v-- != 0);
+    // the pairs (u,v) with v <= u are consecutive in the adjacency matrix, so reset them in one go
+    adj.reset_range(u, 0, u + 1);
+    for(unsigned v = u + 1; v < adj.cols(); ++v) adj.reset({u,v});
+  }
+
+  //! return the neighbors of each vertex as sorted lists
+  AdjacencyLists adjacency_lists() const
+  {
+    AdjacencyLists result(num_vertices());
+    for_each_edge([&result](const Vertex u, const Vertex v){
+        result[u].push_back(v);
+        result[v].push_back(u);
+      });
+    return result;
+  }
+
+  //! return the degree of each vertex
+  std::vector<size_t> degrees() const
+  {
+    std::vector<size_t> result(num_vertices(), 0);
+    for_each_edge([&result](const size_t u, const size_t v){ ++result[u]; ++result[v]; });
+    return result;
+  }
+
+  //! return the set of vertices whose degree is in [min_degree, max_degree]
+  VertexSet vertices_by_degree(const size_t min_degree, const size_t max_degree = -1) const
+  {
+    const std::vector<size_t> deg = degrees();
+    VertexSet result(num_vertices());
+    for(size_t v = 0; v < deg.size(); ++v)
+      if((deg[v] >= min_degree) && (deg[v] <= max_degree)) result.set(v);
+    return result;
+  }
+
+  //! remove all vertices of index >= prefix
+  /** the adjacency matrix stores the rows of 0, ..., prefix-1 first, so this just truncates it word by word **/
+  void truncate(const size_t prefix)
+  {
+    if(prefix >= num_vertices()) return;
+    if(prefix) adj.resize(prefix, prefix); else adj = AdjMatrix();
+    for(auto n2v_iter = name_to_vertex.begin(); n2v_iter != name_to_vertex.end();)
+      if(n2v_iter->second >= prefix) n2v_iter = name_to_vertex.erase(n2v_iter); else ++n2v_iter;
+  }
+
+  //! return the subgraph induced by the vertices in keep; vertices are renumbered consecutively in order of their index
+  Graph induced_subgraph(const VertexSet& keep) const
+  {
+    assert(keep.size() == num_vertices());
+    // if keep is a prefix {0, ..., k-1}, just copy & truncate
+    const size_t k = keep.count();
+    if((k == keep.size()) || ((keep.size() > k) && !keep.test(k) && (keep.find_next(k) == VertexSet::npos))){
+      Graph result(*this);
+      result.truncate(k);
+      return result;
+    }
+    // if the kept vertices form long runs, copy the runs of each kept row word by word
+    size_t runs = 0;
+    for(size_t v = keep.find_first(); v != VertexSet::npos; v = keep.find_next(v))
+      if(!v || !keep.test(v - 1)) ++runs;
+    std::vector<Vertex> new_index(num_vertices());
+    size_t bound = 0;
+    for(size_t v = keep.find_first(), i = 0; v != VertexSet::npos; v = keep.find_next(v), ++i){
+      new_index[v] = i;
+      bound = v + 1;
+    }
+    Graph result;
+    if(runs * GRAPH_WORDWISE_MIN_RUN <= k){
+      result.adj = adj.principal_submatrix(keep);
+    } else {
+      // otherwise, copy the edges between the kept vertices one by one
+      result.adj.resize(k, k);
+      for_each_edge([&](const size_t u, const size_t v){
+          if(keep.test(u) && keep.test(v)) result.add_edge(new_index[u], new_index[v]);
+        }, bound);
+    }
+    for(const auto& n2v: name_to_vertex)
+      if(keep.test(n2v.second)) result.name_to_vertex.emplace(n2v.first, new_index[n2v.second]);
+    return result;
+  }
+
+  //! split the graph into the subgraphs induced by the parts of a partition, given as part number of each vertex
+  /** vertices are renumbered consecutively in order of their index within each part;
+   * this is a single pass over the edges, copied one by one, as opposed to one induced_subgraph() per part
+   **/
+  std::vector<Graph> split(const std::vector<size_t>& part, const size_t num_parts) const
+  {
+    assert(part.size() == num_vertices());
+    std::vector<Vertex> new_index(num_vertices());
+    std::vector<size_t> part_size(num_parts, 0);
+    for(size_t v = 0; v < part.size(); ++v) new_index[v] = part_size[part[v]]++;
+    std::vector<Graph> result;
+    result.reserve(num_parts);
+    for(const size_t n: part_size) result.emplace_back(n);
+    for_each_edge([&](const size_t u, const size_t v){
+        if(part[u] == part[v]) result[part[u]].add_edge(new_index[u], new_index[v]);
+      });
+    for(const auto& n2v: name_to_vertex)
+      result[part[n2v.second]].name_to_vertex.emplace(n2v.first, new_index[n2v.second]);
+    return result;
+  }
+
+  //! return a copy of the graph in which each vertex v is renumbered to new_index[v]
+  /** the edges are copied one by one, since renumbering does not keep runs of consecutive bits together **/
+  Graph relabeled(const std::vector<Vertex>& new_index) const
+  {
+    assert(new_index.size() == num_vertices());
+    Graph result(num_vertices());
+    for_each_edge([&](const Vertex u, const Vertex v){ result.add_edge(new_index[u], new_index[v]); });
+    for(const auto& n2v: name_to_vertex) result.name_to_vertex.emplace(n2v.first, new_index[n2v.second]);
+    return result;
+  }
+
+  //! return the subgraph induced by the vertices that are not isolated
+  Graph non_isolated_subgraph() const
+  {
+    return induced_subgraph(vertices_by_degree(1));
   }
 };
 
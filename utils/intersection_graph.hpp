@@ -0,0 +1,75 @@
+
+#pragma once
+
+#include <vector>
+#include "utils/utils.hpp"
+#include "utils/sequences.hpp"
+#include "utils/stats.hpp"
+#include "utils/union_find.hpp"
+
+// build the character-state intersection graph of the given matrix into g
+// g can be any graph-like type that offers emplace_vertex_by_name() and make_clique()
+// (for example Graph or ExternalEdgeGraph)
+// if components is given, the vertices of each clique are united in it, so it ends up holding the connected components of g
+template<typename GraphT, typename Vertex = typename GraphT::Vertex, typename VertexName = typename GraphT::VertexName>
+void add_species_cliques(const CharMatrix& sequences, GraphT& g, UnionFind* components = NULL)
+{
+  // for each character create vertices for each state
+  const auto size = sequences.size();
+  DEBUG3(std::cout << "read "<<size.first<<" species with "<<size.second<<" characters each"<<std::endl);
+  std::vector<Vertex> clique;
+  clique.reserve(size.second);
+  size_t clique_vertices = 0, max_clique = 0;
+  for(unsigned species = 0; species < size.first; ++species){
+    clique.clear();
+    for(unsigned ch = 0; ch < size.second; ++ch)
+      if(sequences[{species, ch}])
+        clique.push_back(g.emplace_vertex_by_name(VertexName(ch, sequences[{species, ch}])));
+    DEBUG3(std::cout << "adding clique "<<species<<"/"<<size.first<<" containing "<<clique.size()<<" vertices"<<std::endl);
+    g.make_clique(clique);
+    if(components){
+      components->grow(g.num_vertices());
+      components->unite_all(clique.begin(), clique.end());
+    }
+    clique_vertices += clique.size();
+    max_clique = std::max(max_clique, clique.size());
+  }
+  stats::count("cliques", size.first);
+  stats::count("clique_vertices", clique_vertices);
+  stats::count_max("max_clique_size", max_clique);
+}
+
+
+// add the species of the (unreduced) matrix to the intersection graph g of earlier species, as if they came after them
+// columns describes each character of the earlier species as IsolateSNIPs() does: '\0' if it is informative,
+// '-' if it can never become informative, and otherwise the state that all earlier species have;
+// a character becomes informative as soon as a species has another state, and its state then joins the clique of each
+// earlier species, that is, it is adjacent to all vertices so far
+template<typename GraphT, typename Vertex = typename GraphT::Vertex, typename VertexName = typename GraphT::VertexName>
+void append_species_cliques(const CharMatrix& sequences, std::string& columns, GraphT& g)
+{
+  const auto size = sequences.size();
+  assert(size.second == columns.size());
+  std::vector<Vertex> clique;
+  clique.reserve(size.second);
+  size_t reactivated = 0;
+  for(unsigned species = 0; species < size.first; ++species){
+    // first add the states of the characters that become informative, before any vertex of this species exists
+    for(unsigned ch = 0; ch < size.second; ++ch){
+      const char state = sequences[{species, ch}];
+      if(columns[ch] && (columns[ch] != '-') && (columns[ch] != state)){
+        DEBUG3(std::cout << "character "<<ch<<" becomes informative"<<std::endl);
+        const Vertex x = g.emplace_vertex_by_name(VertexName(ch, columns[ch]));
+        for(Vertex v = 0; v < x; ++v) g.add_edge(x, v);
+        columns[ch] = 0;
+        ++reactivated;
+      }
+    }
+    clique.clear();
+    for(unsigned ch = 0; ch < size.second; ++ch)
+      if(!columns[ch]) clique.push_back(g.emplace_vertex_by_name(VertexName(ch, sequences[{species, ch}])));
+    g.make_clique(clique);
+  }
+  stats::count("species_appended", size.first);
+  stats::count("characters_reactivated", reactivated);
+}
@@ -0,0 +1,129 @@
+
+//! file memory.hpp
+/** Memory accounting per subsystem:
+ * containers of the big data structures use a TrackingAllocator tagged with their subsystem,
+ * which keeps track of the current and peak number of bytes allocated by that subsystem.
+ * Also contains an estimate of the memory needed for a conversion, computed before allocating anything.
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+
+namespace memory {
+
+  enum Subsystem { SEQUENCES, CHAR_MATRIX, VERTEX_NAMES, ADJACENCY, NUM_SUBSYSTEMS };
+
+  inline const char* subsystem_name(const Subsystem s)
+  {
+    static const char* names[NUM_SUBSYSTEMS] = {"sequences", "char_matrix", "vertex_names", "adjacency"};
+    return names[s];
+  }
+
+  struct Usage
+  {
+    std::atomic<int64_t> current;
+    std::atomic<int64_t> peak;
+  };
+
+  inline Usage& usage(const Subsystem s)
+  {
+    static Usage all[NUM_SUBSYSTEMS];
+    return all[s];
+  }
+
+  inline void allocated(const Subsystem s, const int64_t bytes)
+  {
+    Usage& u = usage(s);
+    const int64_t now = (u.current += bytes);
+    int64_t peak = u.peak.load();
+    while((now > peak) && !u.peak.compare_exchange_weak(peak, now)) {}
+  }
+
+  inline void deallocated(const Subsystem s, const int64_t bytes)
+  {
+    usage(s).current -= bytes;
+  }
+
+  inline int64_t current_bytes(const Subsystem s)
+  {
+    return usage(s).current.load();
+  }
+
+  inline int64_t peak_bytes(const Subsystem s)
+  {
+    return usage(s).peak.load();
+  }
+
+  //! an allocator that accounts all its allocations to the subsystem S, getting the memory from Base
+  template<typename T, Subsystem S, typename Base = std::allocator<T>>
+  struct TrackingAllocator: public Base
+  {
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef size_t size_type;
+    template<typename U> struct rebind { typedef TrackingAllocator<U, S, typename Base::template rebind<U>::other> other; };
+
+    TrackingAllocator() {}
+    template<typename U, typename B>
+    TrackingAllocator(const TrackingAllocator<U, S, B>&) {}
+
+    T* allocate(const size_t n, const void* = 0)
+    {
+      T* const result = Base().allocate(n);
+      allocated(S, n * sizeof(T));
+      return result;
+    }
+
+    void deallocate(T* const p, const size_t n)
+    {
+      deallocated(S, n * sizeof(T));
+      Base().deallocate(p, n);
+    }
+
+    template<typename U, typename B>
+    bool operator==(const TrackingAllocator<U, S, B>&) const { return true; }
+    template<typename U, typename B>
+    bool operator!=(const TrackingAllocator<U, S, B>&) const { return false; }
+  };
+
+
+  //! estimate of the memory needed per subsystem, derived from the dimensions of the input alone
+  struct Estimate
+  {
+    size_t bytes[NUM_SUBSYSTEMS];
+
+    //! num_symbols is the number of distinct symbols occuring in the sequences
+    Estimate(const size_t num_records, const size_t max_length, const size_t total_length, const size_t num_symbols)
+    {
+      // per-node overhead of the hash maps (node, pointers & bucket)
+      const size_t node_overhead = 4 * sizeof(void*);
+      bytes[SEQUENCES] = total_length + num_records * (node_overhead + 2 * sizeof(std::string));
+      bytes[CHAR_MATRIX] = num_records * max_length;
+      // each character has at most min(#species, #symbols) states, each of which may become a vertex
+      const size_t max_vertices = max_length * std::min(num_records, num_symbols);
+      bytes[VERTEX_NAMES] = max_vertices * (node_overhead + sizeof(std::pair<uint32_t, char>) + sizeof(uint32_t));
+      bytes[ADJACENCY] = (max_vertices * (max_vertices + 1) / 2 + 7) / 8;
+    }
+
+    size_t total() const
+    {
+      size_t result = 0;
+      for(const size_t b: bytes) result += b;
+      return result;
+    }
+
+    //! the most memory that is in use at the same time: the sequences are freed once the matrix is built
+    size_t peak() const
+    {
+      return std::max(bytes[SEQUENCES] + bytes[CHAR_MATRIX], total() - bytes[SEQUENCES]);
+    }
+  };
+
+}// namespace
+
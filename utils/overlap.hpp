@@ -0,0 +1,252 @@
+
+//! file overlap.hpp
+/** Merging overlapping sequences (contigs) into longer ones: an overlap of s1 and s2 at offset o aligns s2 to
+ * s1[o:] (see modified_levenstein_distance()) and is scored by the AVERAGE distance per character of the overlap.
+ *  1. each sequence is sketched by the OVERLAP_SKETCH_SIZE smallest hashes of its k-mers (bottom-k MinHash) and
+ *     only pairs sharing at least min_shared of these hashes are compared,
+ *  2. the overlaps of the candidate pairs (in both orders) are scored on a thread pool, with the bit-parallel
+ *     Levenstein distances (or the Hamming distances if gaps are not expected); each comparison reserves its
+ *     memory from a MemoryBudget first,
+ *  3. sequences that fit completely inside another one are set aside, then the other overlaps are accepted greedily,
+ *     best first, as long as each sequence has at most one successor & one predecessor and no cycle is formed,
+ *  4. each chain of sequences is merged into one contig with linear_levenstein_consensus(); the sequences set aside
+ *     in step 3 are part of the contig of the (uncontained) sequence containing them, so they contribute their names.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include "utils/utils.hpp"
+#include "utils/sequences.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/union_find.hpp"
+#include "utils/stats.hpp"
+
+// number of k-mer hashes kept per sequence
+#define OVERLAP_SKETCH_SIZE 128
+// k-mer hashes occurring in more sequences than this are repeats and do not make pairs candidates
+#define OVERLAP_MAX_OCCURRENCES 64
+
+struct OverlapParams
+{
+  unsigned k = 16;                 // length of the k-mers in the sketches
+  unsigned min_shared = 2;         // number of shared sketch hashes for a pair to be compared
+  unsigned min_overlap = 20;       // minimum number of overlapping characters
+  double max_error = 0.05;         // maximum average distance per overlapping character
+  bool hamming = false;            // score overlaps by Hamming distance (no indels) instead of Levenstein distance
+  unsigned threads = 1;
+  size_t memory_budget = -1;       // bytes that the comparisons running at the same time may use
+};
+
+// s2 aligned to s1 from character 'offset' of s1 on
+struct Overlap
+{
+  unsigned s1, s2;
+  size_t offset;
+  size_t length;                   // number of overlapping characters (min(|s1| - offset, |s2|))
+  unsigned distance;
+
+  double error() const { return (double)distance / length; }
+  // whether s2 fits completely into s1
+  bool contained(const size_t len1, const size_t len2) const { return offset + len2 <= len1; }
+
+  // best first: lowest average distance, then longest overlap
+  bool operator<(const Overlap& o) const
+  {
+    const uint64_t lhs = (uint64_t)distance * o.length, rhs = (uint64_t)o.distance * length;
+    if(lhs != rhs) return lhs < rhs;
+    if(length != o.length) return length > o.length;
+    return std::make_pair(s1, s2) < std::make_pair(o.s1, o.s2);
+  }
+};
+
+//! return the OVERLAP_SKETCH_SIZE smallest distinct hashes of the k-mers of s, sorted
+inline std::vector<uint64_t> kmer_sketch(const std::string& s, const unsigned k)
+{
+  std::vector<uint64_t> hashes;
+  if(s.length() < k) return hashes;
+  hashes.reserve(s.length() - k + 1);
+  // polynomial rolling hash, mixed by the finalizer of splitmix64 so the smallest hashes are a random sample
+  const uint64_t base = 1099511628211ULL;
+  uint64_t top = 1; // base^(k-1)
+  for(unsigned i = 1; i < k; ++i) top *= base;
+  uint64_t h = 0;
+  for(size_t i = 0; i < s.length(); ++i){
+    if(i >= k) h -= top * (unsigned char)s[i - k];
+    h = h * base + (unsigned char)s[i];
+    if(i + 1 >= k){
+      uint64_t x = h;
+      x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+      hashes.push_back(x ^ (x >> 31));
+    }
+  }
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+  if(hashes.size() > OVERLAP_SKETCH_SIZE) hashes.resize(OVERLAP_SKETCH_SIZE);
+  hashes.shrink_to_fit();
+  return hashes;
+}
+
+//! return the pairs (a, b) with a < b of sequences whose sketches share at least min_shared hashes
+inline std::vector<std::pair<unsigned, unsigned>> overlap_candidates(const std::vector<std::vector<uint64_t>>& sketches,
+                                                                     const unsigned min_shared)
+{
+  std::vector<std::pair<uint64_t, unsigned>> index;
+  for(unsigned s = 0; s < sketches.size(); ++s)
+    for(const uint64_t h: sketches[s]) index.emplace_back(h, s);
+  std::sort(index.begin(), index.end());
+
+  std::unordered_map<uint64_t, unsigned> shared;
+  for(size_t first = 0, end; first < index.size(); first = end){
+    for(end = first + 1; (end < index.size()) && (index[end].first == index[first].first); ++end);
+    if(end - first > OVERLAP_MAX_OCCURRENCES) continue;
+    for(size_t i = first; i < end; ++i)
+      for(size_t j = i + 1; j < end; ++j)
+        ++shared[(uint64_t)index[i].second * sketches.size() + index[j].second];
+  }
+
+  std::vector<std::pair<unsigned, unsigned>> result;
+  for(const auto& pair_count: shared)
+    if(pair_count.second >= min_shared)
+      result.emplace_back(pair_count.first / sketches.size(), pair_count.first % sketches.size());
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+//! return the best overlap of s2 to s1 at an offset of at least first_offset (with length 0 if there is none)
+inline Overlap best_overlap(const std::string& s1, const std::string& s2, const OverlapParams& params, const size_t first_offset = 0)
+{
+  Overlap result{0, 0, 0, 0, 0};
+  const size_t min_overlap = std::max(params.min_overlap, 1u);
+  if((s1.length() < min_overlap) || (s2.length() < min_overlap)) return result;
+  const size_t end_offset = s1.length() - min_overlap + 1;
+  if(first_offset >= end_offset) return result;
+  const std::vector<unsigned> distances = params.hamming ?
+      get_hamming_distances(s1, s2, first_offset, end_offset) :
+      modified_levenstein_distance(s1, s2, first_offset, end_offset);
+  for(size_t i = 0; i < distances.size(); ++i){
+    const size_t offset = first_offset + i;
+    const Overlap candidate{0, 0, offset, std::min(s1.length() - offset, s2.length()), distances[i]};
+    if((candidate.error() <= params.max_error) && ((result.length == 0) || (candidate < result))) result = candidate;
+  }
+  return result;
+}
+
+//! merge the overlapping sequences into contigs, each named by the names of its sequences, joined by '+'
+/** the names of the chained sequences come first (in chain order), then those of the sequences contained in the contig;
+ * sequences that overlap nothing are returned unchanged **/
+inline SequenceMap merge_overlaps(const SequenceMap& sequences, const OverlapParams& params)
+{
+  // sort by name, so the result does not depend on the hash order of the map
+  std::vector<std::pair<std::string, std::string>> seqs(sequences.begin(), sequences.end());
+  std::sort(seqs.begin(), seqs.end());
+  const unsigned n = seqs.size();
+  const unsigned none = -1;
+  ThreadPool pool(params.threads);
+
+  // step 1: sketches & candidates
+  std::vector<std::vector<uint64_t>> sketches(n);
+  {
+    const stats::ScopedTimer timer("sketch");
+    pool.parallel_for(n, [&](const size_t s){ sketches[s] = kmer_sketch(seqs[s].second, params.k); });
+  }
+  const std::vector<std::pair<unsigned, unsigned>> candidates = overlap_candidates(sketches, params.min_shared);
+  stats::count("overlap_candidates", candidates.size());
+  DEBUG1(std::cout << candidates.size() << " candidate pairs among "<<n<<" sequences"<<std::endl);
+
+  // step 2: score both orders of each candidate pair
+  std::vector<Overlap> overlaps(2 * candidates.size());
+  {
+    const stats::ScopedTimer timer("score_overlaps");
+    MemoryBudget budget(params.memory_budget);
+    pool.parallel_for(overlaps.size(), [&](const size_t i){
+        const unsigned s1 = (i % 2) ? candidates[i / 2].second : candidates[i / 2].first;
+        const unsigned s2 = (i % 2) ? candidates[i / 2].first : candidates[i / 2].second;
+        const size_t len1 = seqs[s1].second.length();
+        // the match masks of the bit-parallel distance & the distances of all offsets
+        const MemoryReservation reservation(budget, 256 * 8 * ((len1 + 63) / 64) + sizeof(unsigned) * len1);
+        overlaps[i] = best_overlap(seqs[s1].second, seqs[s2].second, params);
+        overlaps[i].s1 = s1;
+        overlaps[i].s2 = s2;
+      });
+  }
+  overlaps.erase(std::remove_if(overlaps.begin(), overlaps.end(), [](const Overlap& o){ return o.length == 0; }), overlaps.end());
+  std::sort(overlaps.begin(), overlaps.end());
+  stats::count("overlaps", overlaps.size());
+
+  // step 3: set the contained sequences aside first, so they cannot take the place of the sequences containing them
+  // in the chains, then accept the overlaps greedily
+  std::vector<unsigned> successor(n, none), predecessor(n, none), container(n, none);
+  unsigned merged = 0, contained = 0;
+  for(const Overlap& o: overlaps)
+    if(o.contained(seqs[o.s1].second.length(), seqs[o.s2].second.length()) && (container[o.s1] == none) && (container[o.s2] == none)){
+      container[o.s2] = o.s1;
+      ++contained;
+    }
+  // a container may have been set aside by a later overlap, so resolve each contained sequence to the uncontained
+  // sequence at the end of its containers (containers are never contained when they are assigned, so there are no cycles)
+  std::vector<unsigned> outer(n, none);
+  for(unsigned s = 0; s < n; ++s)
+    if(container[s] != none){
+      unsigned c = container[s];
+      while(container[c] != none) c = container[c];
+      outer[s] = c;
+    }
+  UnionFind chains(n);
+  for(const Overlap& o: overlaps){
+    if((container[o.s1] != none) || (container[o.s2] != none)) continue;
+    if((successor[o.s1] == none) && (predecessor[o.s2] == none) && chains.unite(o.s1, o.s2)){
+      successor[o.s1] = o.s2;
+      predecessor[o.s2] = o.s1;
+      ++merged;
+    }
+  }
+  stats::count("overlaps_merged", merged);
+  stats::count("sequences_contained", contained);
+  DEBUG1(std::cout << "merging "<<merged<<" overlaps, dropping "<<contained<<" contained sequences"<<std::endl);
+
+  // step 4: merge each chain into a contig, which also contains the sequences contained in the chain
+  std::vector<unsigned> heads, chain_of(n, none);
+  for(unsigned s = 0; s < n; ++s)
+    if((container[s] == none) && (predecessor[s] == none)){
+      for(unsigned t = s; t != none; t = successor[t]) chain_of[t] = heads.size();
+      heads.push_back(s);
+    }
+  std::vector<std::vector<unsigned>> inner(heads.size());
+  for(unsigned s = 0; s < n; ++s)
+    if(outer[s] != none) inner[chain_of[outer[s]]].push_back(s);
+  std::vector<std::pair<std::string, std::string>> contigs(heads.size());
+  {
+    const stats::ScopedTimer timer("merge_contigs");
+    pool.parallel_for(heads.size(), [&](const size_t h){
+        unsigned last = heads[h];
+        std::string name = seqs[last].first;
+        std::string contig = seqs[last].second;
+        for(unsigned next = successor[last]; next != none; last = next, next = successor[next]){
+          // the consensus may have moved the previous sequence a bit, so look for the overlap again in its part
+          const std::string& s2 = seqs[next].second;
+          const size_t first_offset = contig.length() - std::min(contig.length(), seqs[last].second.length());
+          const Overlap o = best_overlap(contig, s2, params, first_offset);
+          name += '+' + seqs[next].first;
+          if(o.length)
+            contig = contig.substr(0, o.offset) + linear_levenstein_consensus(contig, s2, 0, o.offset);
+          else
+            contig += s2;
+        }
+        for(const unsigned s: inner[h]) name += '+' + seqs[s].first;
+        contigs[h] = {std::move(name), std::move(contig)};
+      });
+  }
+
+  SequenceMap result;
+  for(auto& contig: contigs) result.emplace(std::move(contig.first), std::move(contig.second));
+  result.account_strings();
+  return result;
+}
+
@@ -0,0 +1,225 @@
+
+//! file reduction.hpp
+/** Safe reductions of the character-state intersection graph before completing it:
+ * - simplicial vertices (e.g. states occuring in a single species) are removed, since their neighborhood
+ *   is a clique in any completion and, as G is properly colored, it contains no vertex of their color
+ * - true twins (equal closed neighborhoods, e.g. states shared by exactly the same species) are merged into
+ *   one representative; NOTE: the representative then carries the colors (characters) of all its twins,
+ *   so a completion of the reduced graph must not join it to any vertex of these characters (the reduction log
+ *   lists the characters of the twins of each kept vertex, see write_log())
+ * Both reductions are applied until neither applies anymore. The steps are recorded, so that a completion
+ * (set of fill edges) of the reduced graph can be lifted back to the original graph.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
+#include "utils/utils.hpp"
+#include "utils/graph.hpp"
+#include "utils/stats.hpp"
+
+class Reduction
+{
+public:
+  typedef Graph::Vertex Vertex;
+  typedef Graph::Edge Edge;
+  typedef Graph::VertexSet VertexSet;
+
+  enum StepKind { SIMPLICIAL, TWIN };
+
+  struct Step
+  {
+    StepKind kind;
+    Vertex v;
+    Vertex rep; // for TWIN: the vertex that v has been merged into
+  };
+
+protected:
+  std::vector<VertexSet> closed_nbh; // closed neighborhoods of the vertices in the current graph
+  VertexSet alive;
+  std::vector<Step> steps;
+  std::vector<std::vector<Vertex>> twins; // for each representative, all vertices merged into it (recursively)
+
+  void remove_vertex(const Vertex v)
+  {
+    VertexSet& nbh = closed_nbh[v];
+    for(size_t u = nbh.find_first(); u != VertexSet::npos; u = nbh.find_next(u))
+      closed_nbh[u].reset(v);
+    nbh.clear();
+    alive.reset(v);
+  }
+
+  // v is simplicial iff its closed neighborhood is contained in the closed neighborhood of each neighbor
+  bool is_simplicial(const Vertex v) const
+  {
+    const VertexSet& nbh = closed_nbh[v];
+    for(size_t u = nbh.find_first(); u != VertexSet::npos; u = nbh.find_next(u))
+      if((u != v) && !nbh.is_subset_of(closed_nbh[u])) return false;
+    return true;
+  }
+
+  // remove simplicial vertices until there are none left, return the number of removed vertices
+  size_t remove_simplicial()
+  {
+    std::vector<Vertex> to_check;
+    for(size_t v = alive.find_first(); v != VertexSet::npos; v = alive.find_next(v)) to_check.push_back(v);
+    VertexSet queued(alive);
+    size_t removed = 0;
+    while(!to_check.empty()){
+      const Vertex v = to_check.back();
+      to_check.pop_back();
+      queued.reset(v);
+      if(!alive.test(v) || !is_simplicial(v)) continue;
+      // the neighbors of v may become simplicial once v is gone
+      const VertexSet& nbh = closed_nbh[v];
+      for(size_t u = nbh.find_first(); u != VertexSet::npos; u = nbh.find_next(u))
+        if((u != v) && !queued.test(u)) {
+          to_check.push_back(u);
+          queued.set(u);
+        }
+      steps.push_back({SIMPLICIAL, v, v});
+      remove_vertex(v);
+      ++removed;
+    }
+    return removed;
+  }
+
+  // merge all true twins, return the number of merged vertices
+  size_t merge_twins()
+  {
+    // group the vertices by the hash of their closed neighborhoods
+    boost::unordered_map<size_t, std::vector<Vertex>> by_hash;
+    const boost::hash<VertexSet> hasher;
+    for(size_t v = alive.find_first(); v != VertexSet::npos; v = alive.find_next(v))
+      by_hash[hasher(closed_nbh[v])].push_back(v);
+
+    size_t merged = 0;
+    for(const auto& group: by_hash){
+      const std::vector<Vertex>& candidates = group.second;
+      if(candidates.size() < 2) continue;
+      // NOTE: removing a twin removes it from the rows of all its twins, so twins stay twins
+      for(size_t i = 0; i < candidates.size(); ++i){
+        const Vertex rep = candidates[i];
+        if(!alive.test(rep)) continue;
+        for(size_t j = i + 1; j < candidates.size(); ++j){
+          const Vertex v = candidates[j];
+          if(alive.test(v) && (closed_nbh[v] == closed_nbh[rep])){
+            steps.push_back({TWIN, v, rep});
+            twins[rep].push_back(v);
+            twins[rep].insert(twins[rep].end(), twins[v].begin(), twins[v].end());
+            std::vector<Vertex>().swap(twins[v]);
+            remove_vertex(v);
+            ++merged;
+          }
+        }
+      }
+    }
+    return merged;
+  }
+
+public:
+
+  //! reduce g as far as possible
+  Reduction(const Graph& g):
+    closed_nbh(g.num_vertices(), VertexSet(g.num_vertices())),
+    alive(g.num_vertices()),
+    twins(g.num_vertices())
+  {
+    alive.set();
+    for(Vertex v = 0; v < g.num_vertices(); ++v) closed_nbh[v].set(v);
+    g.for_each_edge([this](const Vertex u, const Vertex v){
+        closed_nbh[u].set(v);
+        closed_nbh[v].set(u);
+      });
+    size_t simplicial = 0, merged = 0;
+    while(true){
+      const size_t removed = remove_simplicial();
+      const size_t new_twins = merge_twins();
+      simplicial += removed;
+      merged += new_twins;
+      DEBUG2(std::cout << "removed "<<removed<<" simplicial vertices and merged "<<new_twins<<" twins"<<std::endl);
+      if(!new_twins) break;
+    }
+    stats::count("simplicial_removed", simplicial);
+    stats::count("twins_merged", merged);
+  }
+
+  //! the vertices of the original graph that remain in the reduced graph
+  const VertexSet& kept() const
+  {
+    return alive;
+  }
+
+  const std::vector<Step>& get_steps() const
+  {
+    return steps;
+  }
+
+  //! return the reduced graph, that is, the subgraph of g induced by the kept vertices (renumbered consecutively)
+  Graph reduced_graph(const Graph& g) const
+  {
+    return g.induced_subgraph(alive);
+  }
+
+  //! map each vertex of the reduced graph to its vertex in the original graph
+  std::vector<Vertex> original_vertices() const
+  {
+    std::vector<Vertex> result;
+    result.reserve(alive.count());
+    for(size_t v = alive.find_first(); v != VertexSet::npos; v = alive.find_next(v)) result.push_back(v);
+    return result;
+  }
+
+  //! translate the fill edges of a completion of the reduced graph to fill edges of the original graph
+  /** each twin receives the fill edges of its representative; simplicial vertices need no fill edges **/
+  std::vector<Edge> lift(const std::vector<Edge>& reduced_fill) const
+  {
+    const std::vector<Vertex> original = original_vertices();
+    std::vector<Edge> result;
+    for(const Edge& e: reduced_fill){
+      const Vertex u = original[e.first];
+      const Vertex v = original[e.second];
+      result.emplace_back(u, v);
+      for(const Vertex tu: twins[u]) result.emplace_back(tu, v);
+      for(const Vertex tv: twins[v]){
+        result.emplace_back(u, tv);
+        for(const Vertex tu: twins[u]) result.emplace_back(tu, tv);
+      }
+    }
+    return result;
+  }
+
+  //! write the reduction log: the kept vertices with their names and colors and the applied steps in order
+  /** format:
+   *   k <reduced vertex> <original vertex> <character> <state>   for each kept vertex
+   *   c <reduced vertex> <character>                              for each character of the twins merged into a kept vertex;
+   *                                                               a completion must not join two vertices sharing a character
+   *   s <original vertex>                                         for each removed simplicial vertex
+   *   t <original vertex> <original representative> <character> <state>   for each twin merged into its representative
+   **/
+  void write_log(std::ostream& os, const Graph& g) const
+  {
+    const std::vector<Graph::VertexName> names = g.vertex_names();
+    const std::vector<Vertex> original = original_vertices();
+    os << "# "<<g.num_vertices()<<" vertices, "<<original.size()<<" kept"<<std::endl;
+    for(size_t i = 0; i < original.size(); ++i)
+      os << "k "<<i<<" "<<original[i]<<" "<<names[original[i]].first<<" "<<names[original[i]].second<<std::endl;
+    for(size_t i = 0; i < original.size(); ++i){
+      std::vector<uint32_t> colors;
+      for(const Vertex t: twins[original[i]]) colors.push_back(names[t].first);
+      std::sort(colors.begin(), colors.end());
+      colors.erase(std::unique(colors.begin(), colors.end()), colors.end());
+      for(const uint32_t c: colors)
+        if(c != names[original[i]].first) os << "c "<<i<<" "<<c<<std::endl;
+    }
+    for(const Step& s: steps)
+      if(s.kind == SIMPLICIAL)
+        os << "s "<<s.v<<std::endl;
+      else
+        os << "t "<<s.v<<" "<<s.rep<<" "<<names[s.v].first<<" "<<names[s.v].second<<std::endl;
+  }
+};
+
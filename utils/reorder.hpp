@@ -0,0 +1,161 @@
+
+//! file reorder.hpp
+/** Vertex orderings that improve the locality of the output graph:
+ * vertices get their ids in order of their first occurence, which scatters the members of each clique over all ids.
+ * Each function returns an ordering, that is, the list of vertices in their new order (order[i] becomes vertex i):
+ * - degeneracy: repeatedly take a vertex of minimum degree in the remaining graph (smallest-last ordering)
+ * - rcm: reverse Cuthill-McKee, BFS from a pseudo-peripheral vertex visiting neighbors by increasing degree, reversed
+ * - character: vertices sorted by their name (character, state), grouping the states of each character
+ **/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <numeric>
+#include <algorithm>
+#include "utils/graph.hpp"
+#include "utils/exceptions.hpp"
+
+enum VertexOrder { ORDER_NONE, ORDER_DEGENERACY, ORDER_RCM, ORDER_CHARACTER };
+
+inline VertexOrder parse_vertex_order(const std::string& name)
+{
+  if(name == "none") return ORDER_NONE;
+  if(name == "degeneracy") return ORDER_DEGENERACY;
+  if(name == "rcm") return ORDER_RCM;
+  if(name == "character") return ORDER_CHARACTER;
+  throw except::invalid_options("unknown vertex order " + name + " (use degeneracy, rcm, character or none)");
+}
+
+//! smallest-last ordering: vertices in the order in which they are removed when always removing one of minimum degree
+inline std::vector<Graph::Vertex> degeneracy_ordering(const Graph& g)
+{
+  typedef Graph::Vertex Vertex;
+  const size_t n = g.num_vertices();
+  const Graph::AdjacencyLists adj = g.adjacency_lists();
+  std::vector<size_t> degree(n);
+  for(Vertex v = 0; v < n; ++v) degree[v] = adj[v].size();
+  // buckets[d] contains the vertices of degree d (and outdated entries of vertices that have been removed or whose degree dropped)
+  std::vector<std::vector<Vertex>> buckets(n);
+  for(Vertex v = n; v-- > 0;) buckets[degree[v]].push_back(v);
+  std::vector<bool> removed(n, false);
+  std::vector<Vertex> result;
+  result.reserve(n);
+  size_t min_degree = 0;
+  while(result.size() < n){
+    while(buckets[min_degree].empty()) ++min_degree;
+    const Vertex v = buckets[min_degree].back();
+    buckets[min_degree].pop_back();
+    if(removed[v] || (degree[v] != min_degree)) continue;
+    removed[v] = true;
+    result.push_back(v);
+    for(const Vertex u: adj[v])
+      if(!removed[u]){
+        buckets[--degree[u]].push_back(u);
+        min_degree = std::min(min_degree, degree[u]);
+      }
+  }
+  return result;
+}
+
+//! return the last level of a BFS from start, and its depth in 'depth'
+inline std::vector<Graph::Vertex> bfs_last_level(const Graph::AdjacencyLists& adj, const Graph::Vertex start, size_t& depth)
+{
+  std::vector<bool> seen(adj.size(), false);
+  std::vector<Graph::Vertex> level(1, start), next;
+  seen[start] = true;
+  depth = 0;
+  while(true){
+    next.clear();
+    for(const Graph::Vertex v: level)
+      for(const Graph::Vertex u: adj[v])
+        if(!seen[u]){
+          seen[u] = true;
+          next.push_back(u);
+        }
+    if(next.empty()) return level;
+    level.swap(next);
+    ++depth;
+  }
+}
+
+//! reverse Cuthill-McKee ordering, each connected component starting from a pseudo-peripheral vertex
+inline std::vector<Graph::Vertex> rcm_ordering(const Graph& g)
+{
+  typedef Graph::Vertex Vertex;
+  const size_t n = g.num_vertices();
+  Graph::AdjacencyLists adj = g.adjacency_lists();
+  const auto by_degree = [&adj](const Vertex u, const Vertex v){ return adj[u].size() < adj[v].size(); };
+  for(auto& nbh: adj) std::stable_sort(nbh.begin(), nbh.end(), by_degree);
+
+  // start the components at vertices of small degree
+  std::vector<Vertex> candidates(n);
+  std::iota(candidates.begin(), candidates.end(), 0);
+  std::stable_sort(candidates.begin(), candidates.end(), by_degree);
+
+  std::vector<bool> visited(n, false);
+  std::vector<Vertex> result;
+  result.reserve(n);
+  for(const Vertex candidate: candidates){
+    if(visited[candidate]) continue;
+    // find a pseudo-peripheral vertex: move to a min-degree vertex of the last BFS level as long as the depth grows
+    Vertex start = candidate;
+    size_t depth;
+    std::vector<Vertex> last = bfs_last_level(adj, start, depth);
+    while(true){
+      const Vertex next = *std::min_element(last.begin(), last.end(), by_degree);
+      size_t next_depth;
+      std::vector<Vertex> next_last = bfs_last_level(adj, next, next_depth);
+      if(next_depth <= depth) break;
+      start = next;
+      depth = next_depth;
+      last.swap(next_last);
+    }
+    // Cuthill-McKee BFS
+    const size_t first = result.size();
+    result.push_back(start);
+    visited[start] = true;
+    for(size_t i = first; i < result.size(); ++i)
+      for(const Vertex u: adj[result[i]])
+        if(!visited[u]){
+          visited[u] = true;
+          result.push_back(u);
+        }
+  }
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+//! vertices sorted by their names (character, state), unnamed vertices last
+inline std::vector<Graph::Vertex> character_ordering(const Graph& g)
+{
+  const std::vector<Graph::VertexName> names = g.vertex_names();
+  std::vector<Graph::Vertex> result(g.num_vertices());
+  std::iota(result.begin(), result.end(), 0);
+  std::stable_sort(result.begin(), result.end(), [&names](const Graph::Vertex u, const Graph::Vertex v){ return names[u] < names[v]; });
+  return result;
+}
+
+inline std::vector<Graph::Vertex> vertex_ordering(const Graph& g, const VertexOrder order)
+{
+  switch(order){
+    case ORDER_DEGENERACY: return degeneracy_ordering(g);
+    case ORDER_RCM: return rcm_ordering(g);
+    case ORDER_CHARACTER: return character_ordering(g);
+    default: {
+      std::vector<Graph::Vertex> identity(g.num_vertices());
+      std::iota(identity.begin(), identity.end(), 0);
+      return identity;
+    }
+  }
+}
+
+//! return the new index of each vertex, given the ordering
+inline std::vector<Graph::Vertex> ordering_to_index(const std::vector<Graph::Vertex>& ordering)
+{
+  std::vector<Graph::Vertex> result(ordering.size());
+  for(size_t i = 0; i < ordering.size(); ++i) result[ordering[i]] = i;
+  return result;
+}
+
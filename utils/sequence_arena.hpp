@@ -0,0 +1,168 @@
+
+//! file sequence_arena.hpp
+/** A SequenceArena owns all names & sequences of one fasta load in a single buffer:
+ * each record is a name followed by its sequence, both stored as contiguous spans (offsets into the buffer).
+ * If the sizes are known beforehand (see io::scan_fasta_file()), the buffer is allocated exactly once,
+ * and all of it is released in one shot by release() or the destructor.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cassert>
+#include <numeric>
+#include <algorithm>
+#include <boost/unordered_set.hpp>
+#include <boost/functional/hash.hpp>
+#include "utils/utils.hpp"
+#include "utils/memory.hpp"
+
+class SequenceArena
+{
+public:
+  // a range of bytes in the arena, given by offset since the buffer may move while it grows
+  struct Span
+  {
+    size_t offset;
+    size_t length;
+  };
+
+  struct Record
+  {
+    Span name;
+    Span sequence;
+  };
+
+protected:
+  // the index stores records wrapped in a struct, since boost uses a different bucket policy for integer keys than for strings
+  struct NameKey
+  {
+    unsigned record;
+  };
+
+  // hash & compare records by their names, the hash is the same as boost::hash<std::string> of the name
+  struct NameHash
+  {
+    const SequenceArena* arena;
+    size_t operator()(const NameKey& k) const
+    {
+      const Span& n = arena->records[k.record].name;
+      return boost::hash_range(arena->data(n), arena->data(n) + n.length);
+    }
+  };
+  struct NameEqual
+  {
+    const SequenceArena* arena;
+    bool operator()(const NameKey& k1, const NameKey& k2) const
+    {
+      const Span& n1 = arena->records[k1.record].name;
+      const Span& n2 = arena->records[k2.record].name;
+      return (n1.length == n2.length) && !std::memcmp(arena->data(n1), arena->data(n2), n1.length);
+    }
+  };
+  typedef boost::unordered_set<NameKey, NameHash, NameEqual, memory::TrackingAllocator<NameKey, memory::SEQUENCES>> NameIndex;
+
+  std::vector<char, memory::TrackingAllocator<char, memory::SEQUENCES>> bytes;
+  std::vector<Record, memory::TrackingAllocator<Record, memory::SEQUENCES>> records;
+  NameIndex names;
+
+public:
+
+  // start with as many buckets as a default constructed map, to enumerate names in the same order
+  SequenceArena():
+    names(default_buckets, NameHash{this}, NameEqual{this})
+  {}
+
+  // the index refers back to the arena, so arenas can be neither copied nor moved
+  SequenceArena(const SequenceArena&) = delete;
+  SequenceArena& operator=(const SequenceArena&) = delete;
+
+  //! make room for the given number of records and bytes (names & sequences) so no reallocation is needed while loading
+  void reserve(const size_t num_records, const size_t num_bytes)
+  {
+    records.reserve(num_records);
+    bytes.reserve(num_bytes);
+  }
+
+  //! start a new record with the given name, return false if a record with this name exists already
+  bool add_record(const char* name, const size_t length)
+  {
+    const Span name_span = {bytes.size(), length};
+    bytes.insert(bytes.end(), name, name + length);
+    records.push_back({name_span, {bytes.size(), 0}});
+    if(!names.insert(NameKey{(unsigned)records.size() - 1}).second){
+      records.pop_back();
+      bytes.resize(name_span.offset);
+      return false;
+    } else return true;
+  }
+
+  //! append to the sequence of the last record
+  /** NOTE: the last record must have been added last, so its sequence stays contiguous */
+  void append(const char* seq, const size_t length)
+  {
+    assert(!records.empty());
+    bytes.insert(bytes.end(), seq, seq + length);
+    records.back().sequence.length += length;
+  }
+
+  size_t size() const { return records.size(); }
+  bool empty() const { return records.empty(); }
+  size_t num_bytes() const { return bytes.size(); }
+
+  const Record& operator[](const size_t r) const { return records[r]; }
+  const char* data(const Span& s) const { return bytes.data() + s.offset; }
+  std::string name(const size_t r) const { return std::string(data(records[r].name), records[r].name.length); }
+  const char* sequence(const size_t r) const { return data(records[r].sequence); }
+  size_t sequence_length(const size_t r) const { return records[r].sequence.length; }
+
+  //! the records in the order in which a SequenceMap with the same contents enumerates its sequences
+  /** NOTE: the name index hashes like a SequenceMap and sees the same insertions, so its buckets are the same */
+  std::vector<unsigned> map_order() const
+  {
+    std::vector<unsigned> result;
+    result.reserve(names.size());
+    for(const NameKey& k: names) result.push_back(k.record);
+    return result;
+  }
+
+  //! the records ordered by their sequences, then by their names
+  /** unlike map_order(), this does not depend on the order of the records in the file or on the hash function */
+  std::vector<unsigned> canonical_order() const
+  {
+    const auto less = [this](const Span& s1, const Span& s2){
+        const int cmp = std::memcmp(data(s1), data(s2), std::min(s1.length, s2.length));
+        return cmp ? (cmp < 0) : (s1.length < s2.length);
+      };
+    std::vector<unsigned> result(records.size());
+    std::iota(result.begin(), result.end(), 0);
+    std::sort(result.begin(), result.end(), [&](const unsigned r1, const unsigned r2){
+        const Record& x = records[r1];
+        const Record& y = records[r2];
+        if(less(x.sequence, y.sequence)) return true;
+        if(less(y.sequence, x.sequence)) return false;
+        return less(x.name, y.name);
+      });
+    return result;
+  }
+
+  //! remove all records, but keep the buffers for the next load
+  void clear()
+  {
+    // a cleared index keeps its buckets, which would change the map order of the next load
+    NameIndex(default_buckets, NameHash{this}, NameEqual{this}).swap(names);
+    records.clear();
+    bytes.clear();
+  }
+
+  //! free all memory held by the arena
+  void release()
+  {
+    NameIndex(default_buckets, NameHash{this}, NameEqual{this}).swap(names);
+    decltype(records)().swap(records);
+    decltype(bytes)().swap(bytes);
+  }
+};
+
@@ -4,23 +4,33 @@
 
 #include <boost/unordered_map.hpp>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
 #include "utils/vector2d.hpp"
+#include "utils/memory.hpp"
+#include "utils/sequence_arena.hpp"
+#include "utils/thread_pool.hpp"
 
 #define BASES "ABCDEFGHIJKLMNOPQRSTUVWXYZ*-"
 #define CYCLIC_SEQUENCE_INDICATOR "(c)"
 #define REVERSE_SEQUENCE_INDICATOR "(rev)"
 
-const char* COMPLEMENTARY_BASES = "ATAUCGRYMK";
+const char* const COMPLEMENTARY_BASES = "ATAUCGRYMK";
 
 
 // forward declaration to read fasta files in Sequences constructor
 class SequenceMap;
 namespace io{
-  void read_fasta_file(const std::string& input, SequenceMap& name_to_seq, const std::string& acceptable_bases);
+  inline void read_fasta_file(const std::string& input, SequenceMap& name_to_seq, const std::string& acceptable_bases);
 }
 
   // return the index behind the real name if name is "(real_name)(rev)" and 0 otherwise
-  unsigned is_reversed_sequence(const std::string& name)
+  inline unsigned is_reversed_sequence(const std::string& name)
   {
     unsigned start_of_rev_indicator = name.length() - strlen(REVERSE_SEQUENCE_INDICATOR);
     const unsigned end_of_name = start_of_rev_indicator - 1;
@@ -42,7 +52,7 @@ namespace io{
   }
 
   // change name as to indicate that it's referring to a reversed sequence
-  void indicate_reversal(std::string& name)
+  inline void indicate_reversal(std::string& name)
   {
     // if the sequence is already reversed, just remove the reverse indicator, otherwise, add a reverse indicator
     const unsigned start_of_rev_indicator = is_reversed_sequence(name);
@@ -53,34 +63,82 @@ namespace io{
   }
 
 
+  // the complement of a base according to COMPLEMENTARY_BASES, or 'N' if it does not have a complement
+  constexpr char complement_of(const unsigned char base)
+  {
+    return (base == 'A') ? 'T' : (base == 'T') ? 'A' : (base == 'U') ? 'A' : (base == 'C') ? 'G' : (base == 'G') ? 'C' :
+           (base == 'R') ? 'Y' : (base == 'Y') ? 'R' : (base == 'M') ? 'K' : (base == 'K') ? 'M' : 'N';
+  }
+
+#define COMPLEMENT_ROW4(b) complement_of(b), complement_of(b + 1), complement_of(b + 2), complement_of(b + 3)
+#define COMPLEMENT_ROW16(b) COMPLEMENT_ROW4(b), COMPLEMENT_ROW4(b + 4), COMPLEMENT_ROW4(b + 8), COMPLEMENT_ROW4(b + 12)
+#define COMPLEMENT_ROW64(b) COMPLEMENT_ROW16(b), COMPLEMENT_ROW16(b + 16), COMPLEMENT_ROW16(b + 32), COMPLEMENT_ROW16(b + 48)
+  // the complement of each byte; all bases that have a complement are in 0x40 - 0x5f
+  alignas(16) constexpr char COMPLEMENT_TABLE[256] = {
+    COMPLEMENT_ROW64(0), COMPLEMENT_ROW64(64), COMPLEMENT_ROW64(128), COMPLEMENT_ROW64(192)
+  };
+#undef COMPLEMENT_ROW64
+#undef COMPLEMENT_ROW16
+#undef COMPLEMENT_ROW4
+
   // get the complement of the given base, or 'N' if it does not have a complement
-  char get_complement(const char base)
+  inline char get_complement(const char base)
   {
-    const char* complement_index = std::strchr(COMPLEMENTARY_BASES, base);
-    if(complement_index != NULL){
-      const int offset = (complement_index - COMPLEMENTARY_BASES);
-      assert(offset >= 0);
-      char result = COMPLEMENTARY_BASES[(offset % 2) ? offset - 1 : offset + 1];
-      return result;
-    } else return 'N';
+    return COMPLEMENT_TABLE[(unsigned char)base];
   }
 
-  // reverse complement a given string in place
-  void reverse_complement_inplace(std::string& sequence)
-  {
-    const int seq_len = sequence.length();
-    const int last_index = seq_len - 1;
-    for(int i = 0; 2 * i < last_index; ++i){
-      const char swap_base = sequence[i];
-      sequence[i] = get_complement(sequence[last_index - i]);
-      sequence[last_index - i] = get_complement(swap_base);
+#ifdef __SSSE3__
+  // complement 16 bases at once: look up the low nibble in the rows 0x40 and 0x50 of the table, and use 'N' elsewhere
+  inline __m128i complement_block(const __m128i bases)
+  {
+    const __m128i row4 = _mm_load_si128(reinterpret_cast<const __m128i*>(COMPLEMENT_TABLE + 0x40));
+    const __m128i row5 = _mm_load_si128(reinterpret_cast<const __m128i*>(COMPLEMENT_TABLE + 0x50));
+    const __m128i low = _mm_and_si128(bases, _mm_set1_epi8(0x0f));
+    const __m128i high = _mm_and_si128(bases, _mm_set1_epi8((char)0xf0));
+    const __m128i in4 = _mm_cmpeq_epi8(high, _mm_set1_epi8(0x40));
+    const __m128i in5 = _mm_cmpeq_epi8(high, _mm_set1_epi8(0x50));
+    const __m128i result = _mm_or_si128(_mm_and_si128(in4, _mm_shuffle_epi8(row4, low)),
+                                        _mm_and_si128(in5, _mm_shuffle_epi8(row5, low)));
+    return _mm_or_si128(result, _mm_andnot_si128(_mm_or_si128(in4, in5), _mm_set1_epi8('N')));
+  }
+
+  // reverse complement 16 bases
+  inline __m128i reverse_complement_block(const __m128i bases)
+  {
+    const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(complement_block(bases), reverse);
+  }
+#endif
+
+  // reverse complement the characters first, ..., last of a sequence in place
+  inline void reverse_complement_inplace(char* first, char* last)
+  {
+#ifdef __SSSE3__
+    // swap reverse complemented blocks of 16 bases from both ends (see -march in CMakeLists.txt)
+    for(; last - first >= 31; first += 16, last -= 16){
+      const __m128i front = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+      const __m128i back = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last - 15));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(first), reverse_complement_block(back));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(last - 15), reverse_complement_block(front));
+    }
+#endif
+    for(; first < last; ++first, --last){
+      const char swap_base = *first;
+      *first = get_complement(*last);
+      *last = get_complement(swap_base);
     }
-    // reverse the middle if the sequence length is even
-    if(seq_len % 2) sequence[last_index / 2] = get_complement(sequence[last_index / 2]);
+    // complement the middle if the sequence length is odd
+    if(first == last) *first = get_complement(*first);
+  }
+
+  // reverse complement a given string in place
+  inline void reverse_complement_inplace(std::string& sequence)
+  {
+    if(!sequence.empty()) reverse_complement_inplace(&sequence[0], &sequence[0] + sequence.length() - 1);
   }
 
   // return the reverse complement of a sequence
-  std::string reverse_complement(const std::string& sequence)
+  inline std::string reverse_complement(const std::string& sequence)
   {
     std::string out(sequence);
     reverse_complement_inplace(out);
@@ -89,7 +147,7 @@ namespace io{
 
 
   // return the reverse complement of a sequence, modifying its name to account for it
-  std::string named_reverse_complement(const std::string& sequence, std::string& name)
+  inline std::string named_reverse_complement(const std::string& sequence, std::string& name)
   {
     std::string out(sequence);
     reverse_complement_inplace(out);
@@ -99,32 +157,132 @@ namespace io{
 
 
 // a SequenceMap assigns each contig name a sequence of base pairs
-class SequenceMap: public boost::unordered_map<std::string, std::string>
+// the map itself is accounted to the SEQUENCES subsystem by its allocator, the strings by account_strings()
+class SequenceMap: public boost::unordered_map<std::string, std::string, boost::hash<std::string>, std::equal_to<std::string>,
+                       memory::TrackingAllocator<std::pair<const std::string, std::string>, memory::SEQUENCES>>
 {
-  using Parent = boost::unordered_map<std::string, std::string>;
+  using Parent = boost::unordered_map<std::string, std::string, boost::hash<std::string>, std::equal_to<std::string>,
+                       memory::TrackingAllocator<std::pair<const std::string, std::string>, memory::SEQUENCES>>;
   using Parent::unordered_map;
 
+  size_t string_bytes = 0; // bytes of the strings currently accounted to the SEQUENCES subsystem
+
 public:
 
+  SequenceMap(): Parent() {}
+
   //! a constructor that reads sequence data from a file
   SequenceMap(const std::string& filename):
     Parent::unordered_map()
   {
     io::read_fasta_file(filename, *this, "");
   }
+
+  // the accounted strings belong to exactly one map, so maps can be moved, but not copied
+  SequenceMap(const SequenceMap&) = delete;
+  SequenceMap& operator=(const SequenceMap&) = delete;
+
+  SequenceMap(SequenceMap&& other):
+    Parent(std::move(other)),
+    string_bytes(other.string_bytes)
+  {
+    other.string_bytes = 0;
+  }
+
+  SequenceMap& operator=(SequenceMap&& other)
+  {
+    if(this != &other){
+      Parent::operator=(std::move(other));
+      memory::deallocated(memory::SEQUENCES, string_bytes);
+      string_bytes = other.string_bytes;
+      other.string_bytes = 0;
+    }
+    return *this;
+  }
+
+  ~SequenceMap()
+  {
+    memory::deallocated(memory::SEQUENCES, string_bytes);
+  }
+
+  //! update the memory accounted for the names & sequences stored in the map
+  void account_strings()
+  {
+    size_t bytes = 0;
+    for(const auto& name_seq: *this) bytes += name_seq.first.capacity() + name_seq.second.capacity();
+    memory::allocated(memory::SEQUENCES, (int64_t)bytes - (int64_t)string_bytes);
+    string_bytes = bytes;
+  }
 };
 
-class CharMatrix: public std::vector2d<char>
+//! reverse complement all sequences of the map and mark their names with indicate_reversal(), using the given number of threads
+inline void reverse_complement_all(SequenceMap& sequences, const unsigned threads = 1)
 {
-  using Parent = std::vector2d<char>;
+  // the names are the keys of the map, so the entries are taken out and put back in under their new names
+  std::vector<std::pair<std::string, std::string>> entries;
+  entries.reserve(sequences.size());
+  for(auto& name_seq: sequences) entries.emplace_back(name_seq.first, std::move(name_seq.second));
+  sequences.clear();
+
+  const auto reverse_entry = [&entries](const size_t i){
+      indicate_reversal(entries[i].first);
+      reverse_complement_inplace(entries[i].second);
+    };
+  if(threads > 1){
+    // blocks of consecutive entries, a few per thread so long sequences even out
+    const size_t num_blocks = std::min<size_t>(entries.size(), 4 * threads);
+    ThreadPool pool(threads);
+    pool.parallel_for(num_blocks, [&](const size_t b){
+        for(size_t i = b * entries.size() / num_blocks; i < (b + 1) * entries.size() / num_blocks; ++i) reverse_entry(i);
+      });
+  } else for(size_t i = 0; i < entries.size(); ++i) reverse_entry(i);
+
+  for(auto& entry: entries) sequences.emplace(std::move(entry.first), std::move(entry.second));
+  sequences.account_strings();
+}
+
+// the matrix is stored character by character, so each character is a row of species, starting on a cache line
+class CharMatrix: public std::vector2d<char, memory::TrackingAllocator<char, memory::CHAR_MATRIX, std::aligned_allocator<char>>>
+{
+  using Parent = std::vector2d<char, memory::TrackingAllocator<char, memory::CHAR_MATRIX, std::aligned_allocator<char>>>;
   using Parent::columns;
 
+  // whether any of the n states at p differs from state, comparing blocks of 64 states without branches
+  static bool any_differs(const char* const p, const size_t n, const char state)
+  {
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64){
+      unsigned char diff = 0;
+      for(size_t j = 0; j < 64; ++j) diff |= (unsigned char)(p[i + j] ^ state);
+      if(diff) return true;
+    }
+    for(; i < n; ++i) if(p[i] != state) return true;
+    return false;
+  }
+
 public:
 
-  CharMatrix(const SequenceMap& sequences):
-    Parent(sequences.size(), sequences.begin()->second.size())
+  CharMatrix() {}
+
+  CharMatrix(const SequenceMap& sequences)
+  {
+    assign(sequences);
+  }
+
+  CharMatrix(const SequenceArena& sequences)
+  {
+    assign(sequences);
+  }
+
+  //! (re-)fill the matrix with the given sequences, reusing the memory that is already allocated
+  void assign(const SequenceMap& sequences)
   {
-    const unsigned num_chars = sequences.begin()->second.size();
+    const unsigned num_chars = sequences.empty() ? 0 : sequences.begin()->second.size();
+    if(num_chars == 0){
+      Parent::clear();
+      return;
+    }
+    Parent::resize(sequences.size(), num_chars);
     unsigned seq_id = 0;
     for(const auto& seq: sequences){
       assert(seq.second.size() == num_chars);
@@ -134,23 +292,81 @@ public:
     }
   }
 
-  //! remove all characters that have only one state
+  //! (re-)fill the matrix with the sequences of the arena, in the same species order as a SequenceMap would have
+  void assign(const SequenceArena& sequences)
+  {
+    assign(sequences, sequences.map_order());
+  }
+
+  //! (re-)fill the matrix with the sequences of the given records of the arena, in this order (see SequenceArena::canonical_order())
+  void assign(const SequenceArena& sequences, const std::vector<unsigned>& records)
+  {
+    const unsigned num_chars = records.empty() ? 0 : sequences.sequence_length(records.front());
+    if(num_chars == 0){
+      Parent::clear();
+      return;
+    }
+    Parent::resize(records.size(), num_chars);
+    unsigned seq_id = 0;
+    for(const unsigned r: records){
+      assert(sequences.sequence_length(r) == num_chars);
+      const char* const seq = sequences.sequence(r);
+      for(unsigned i = 0; i < num_chars; ++i)
+        operator[]({seq_id, i}) = seq[i];
+      ++seq_id;
+    }
+  }
+
+  //! remove all characters that have only one state, return the number of remaining characters
   //NOTE: removed characters are encoded as characters having state '\0'
-  void IsolateSNIPs()
+  /** if removed_states is given, it receives the state of each removed character in the first species ('-' if it
+   * has no state there, so the character is never informative) and '\0' for each remaining character **/
+  unsigned IsolateSNIPs(std::string* removed_states = NULL)
   {
     const auto sz = size();
+    unsigned kept = sz.second;
+    if(removed_states) removed_states->assign(sz.second, 0);
     for(unsigned ch = 0; ch < sz.second; ++ch){
-      const char first_state = operator[]({0, ch});
-      bool broke = false;
-      if(first_state != '-'){
-        for(unsigned species = 1; species < sz.first; ++species)
-          if((broke = ((operator[]({species, ch}) != first_state) || (operator[]({species, ch}) == '-')))) break;
-      } else broke = false;
+      // the states of all species for this character
+      const auto states = Parent::row(ch);
+      const char first_state = states[0];
+      // since first_state is not '-', a species having state '-' differs from it
+      const bool broke = (first_state != '-') && any_differs(states.data() + 1, sz.first - 1, first_state);
       if(!broke){
-        for(unsigned species = 0; species < sz.first; ++species)
-          operator[]({species, ch}) = 0;
+        if(removed_states) (*removed_states)[ch] = first_state;
+        std::fill_n(states.data(), sz.first, 0);
+        --kept;
       }
     }
+    return kept;
+  }
+
+  //! a 64-bit FNV-1a hash of the contents, in the order of the species
+  /** the instance depends on the order of the species (IsolateSNIPs() looks at the first species and the vertices are
+   * numbered in order of their first occurrence), so the species should be in canonical order (see
+   * SequenceArena::canonical_order()) for the hash to identify the instance regardless of the order of the records;
+   * each species is hashed on its own, then the species hashes are hashed in order together with the dimensions.
+   * Unlike boost::hash, the result is the same on all platforms and library versions, so it can be stored on disk **/
+  uint64_t content_hash() const
+  {
+    const uint64_t fnv_offset = 14695981039346656037ULL;
+    const uint64_t fnv_prime = 1099511628211ULL;
+    const size_t num_species = Parent::empty() ? 0 : size().first;
+    const size_t num_chars = Parent::empty() ? 0 : size().second;
+    // the matrix is stored character by character, so hash all species in one sweep
+    std::vector<uint64_t> species_hash(num_species, fnv_offset);
+    for(size_t ch = 0; ch < num_chars; ++ch)
+      for(size_t species = 0; species < num_species; ++species)
+        species_hash[species] = (species_hash[species] ^ (unsigned char)operator[]({species, ch})) * fnv_prime;
+
+    uint64_t result = fnv_offset;
+    const auto add_word = [&](uint64_t word){
+      for(unsigned i = 0; i < 8; ++i, word >>= 8) result = (result ^ (word & 0xff)) * fnv_prime;
+    };
+    add_word(num_species);
+    add_word(num_chars);
+    for(const uint64_t h: species_hash) add_word(h);
+    return result;
   }
 };
 
@@ -0,0 +1,163 @@
+
+//! file stats.hpp
+/** Low-overhead instrumentation that is compiled into every build (unlike the DEBUG/STAT macros):
+ * phase timers and counters are collected in a global registry and can be written as JSON.
+ * Only coarse events (phases, cliques, files) should be recorded, never single edges or bits.
+ **/
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
+#include "utils/memory.hpp"
+
+namespace stats {
+
+  class Registry
+  {
+  public:
+    typedef std::vector<std::pair<std::string, double>> Timers;
+    typedef std::vector<std::pair<std::string, uint64_t>> Counters;
+
+  protected:
+    // entries are kept in the order in which they were first recorded
+    Timers timers;
+    Counters counters;
+    mutable std::mutex lock;
+
+    template<typename List>
+    static typename List::value_type::second_type& entry(List& l, const std::string& name)
+    {
+      for(auto& e: l) if(e.first == name) return e.second;
+      l.emplace_back(name, 0);
+      return l.back().second;
+    }
+
+  public:
+    //! add seconds to the time spent in phase 'name'
+    void add_time(const std::string& name, const double seconds)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      entry(timers, name) += seconds;
+    }
+
+    //! add value to the counter 'name'
+    void count(const std::string& name, const uint64_t value = 1)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      entry(counters, name) += value;
+    }
+
+    //! set the counter 'name' to the maximum of its current value and value
+    void count_max(const std::string& name, const uint64_t value)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      uint64_t& e = entry(counters, name);
+      if(value > e) e = value;
+    }
+
+    //! set the counter 'name' to value
+    void set(const std::string& name, const uint64_t value)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      entry(counters, name) = value;
+    }
+
+    Timers get_timers() const
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      return timers;
+    }
+
+    Counters get_counters() const
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      return counters;
+    }
+  };
+
+  //! the registry that all instrumentation reports to
+  inline Registry& global()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  inline void count(const std::string& name, const uint64_t value = 1)
+  {
+    global().count(name, value);
+  }
+
+  inline void count_max(const std::string& name, const uint64_t value)
+  {
+    global().count_max(name, value);
+  }
+
+  inline void set(const std::string& name, const uint64_t value)
+  {
+    global().set(name, value);
+  }
+
+  //! measure the time between construction and destruction (or stop()) as phase 'name'
+  class ScopedTimer
+  {
+    const std::string name;
+    const std::chrono::steady_clock::time_point start;
+    bool running = true;
+  public:
+    ScopedTimer(const std::string& _name):
+      name(_name), start(std::chrono::steady_clock::now())
+    {}
+    ~ScopedTimer()
+    {
+      stop();
+    }
+    void stop()
+    {
+      if(running){
+        global().add_time(name, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        running = false;
+      }
+    }
+  };
+
+  //! the maximum resident set size of this process so far
+  inline uint64_t peak_rss_bytes()
+  {
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)) return 0;
+    return (uint64_t)usage.ru_maxrss * 1024; // ru_maxrss is in kilobytes on Linux
+  }
+
+  //! write all collected timers & counters, the memory used by each subsystem, as well as the peak RSS as JSON object
+  inline void write_json(std::ostream& os, const Registry& r = global())
+  {
+    os << "{" << std::endl << "  \"phases\": {";
+    bool first = true;
+    for(const auto& t: r.get_timers()){
+      os << (first ? "" : ",") << std::endl << "    \"" << t.first << "\": " << t.second;
+      first = false;
+    }
+    os << std::endl << "  }," << std::endl << "  \"counters\": {";
+    first = true;
+    for(const auto& c: r.get_counters()){
+      os << (first ? "" : ",") << std::endl << "    \"" << c.first << "\": " << c.second;
+      first = false;
+    }
+    os << std::endl << "  }," << std::endl << "  \"memory\": {";
+    for(unsigned s = 0; s < memory::NUM_SUBSYSTEMS; ++s){
+      const memory::Subsystem sub = (memory::Subsystem)s;
+      os << (s ? "," : "") << std::endl << "    \"" << memory::subsystem_name(sub) << "\": {\"current_bytes\": "
+         << memory::current_bytes(sub) << ", \"peak_bytes\": " << memory::peak_bytes(sub) << "}";
+    }
+    os << std::endl << "  }," << std::endl;
+    os << "  \"peak_rss_bytes\": " << peak_rss_bytes() << std::endl << "}" << std::endl;
+  }
+
+}// namespace
+
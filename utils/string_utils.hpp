@@ -8,12 +8,20 @@
 #define STRING_UTILS_HPP
 
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <thread>
 #include <boost/unordered_map.hpp>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include "utils/exceptions.hpp"
 #include "utils/vector2d.hpp"
 
 #define WHITESPACES " \t"
+// maximum number of cells of the DP table that linear_levenstein_consensus() keeps at once to trace a block of rows
+#define CONSENSUS_BLOCK_CELLS (1u << 20)
 
 typedef boost::unordered_map<std::string, unsigned> StringCount;
 
@@ -32,7 +40,7 @@ inline void skip_all(std::string& s, const std::string& to_skip)
 }
 
 //! consume an integer from the beginning of s and return it
-long read_single_number(std::string& s)
+inline long read_single_number(std::string& s)
 {
   long result = std::stoi(s.c_str());
   // remove result from the number
@@ -42,7 +50,7 @@ long read_single_number(std::string& s)
 }
 
 //! remove leading & trailing chars (whitespaces by default) from str
-std::string trim(const std::string& str, const std::string& to_remove = WHITESPACES)
+inline std::string trim(const std::string& str, const std::string& to_remove = WHITESPACES)
 {
     const size_t first = str.find_first_not_of(to_remove);
     if(first == std::string::npos) return "";
@@ -50,25 +58,39 @@ std::string trim(const std::string& str, const std::string& to_remove = WHITESPA
     return str.substr(first, last - first + 1);
 }
 
-//! returns the Hamming distance between the maximal prefixes of equal length
-unsigned hamming_distance(const std::string& s1, const std::string& s2)
-{
-  unsigned len = std::min(s1.length(), s2.length()) + 1;
-  unsigned result = 0;
-  while(len--) result += (s1[len] != s2[len]);
-  return result;
-}
-//! returns the Hamming distance between the maximal prefixes of equal length (char* version)
+//! returns the Hamming distance between the first length characters of s1 and s2 (char* version)
 /** Note: no checks are performed, use at own risk
+ * compares 32 (AVX2) or 16 (SSE2) characters at once if the target supports it (see -march in CMakeLists.txt)
  */
-unsigned hamming_distance(const char* s1, const char* s2, unsigned length)
+inline unsigned hamming_distance(const char* s1, const char* s2, const unsigned length)
 {
   unsigned result = 0;
-  while(length--) result += (s1[length] != s2[length]);
+  unsigned i = 0;
+#ifdef __AVX2__
+  for(; i + 32 <= length; i += 32){
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s1 + i));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s2 + i));
+    result += 32 - __builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+  }
+#endif
+#ifdef __SSE2__
+  for(; i + 16 <= length; i += 16){
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1 + i));
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s2 + i));
+    result += 16 - __builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+  }
+#endif
+  for(; i < length; ++i) result += (s1[i] != s2[i]);
   return result;
 }
 
-std::vector<unsigned> get_hamming_distances(const std::string& s1, const std::string& s2, const size_t lower_index, const size_t upper_index)
+//! returns the Hamming distance between the maximal prefixes of equal length
+inline unsigned hamming_distance(const std::string& s1, const std::string& s2)
+{
+  return hamming_distance(s1.data(), s2.data(), std::min(s1.length(), s2.length()));
+}
+
+inline std::vector<unsigned> get_hamming_distances(const std::string& s1, const std::string& s2, const size_t lower_index, const size_t upper_index)
 {
   std::vector<unsigned> result(upper_index - lower_index);
   for(unsigned index = lower_index; index < upper_index; ++index){
@@ -82,6 +104,140 @@ std::vector<unsigned> get_hamming_distances(const std::string& s1, const std::st
 enum Op : unsigned char {NOOP, DEL_LEFT, DEL_RIGHT, CHANGE};
 typedef std::vector2d<Op> Levenstein_Op_Table;
 
+// advance a block of 64 rows of a column of the DP table by one character (Myers/Hyyro):
+// vp/vn have bit r set iff the score of row r is one more/less than that of row r - 1, eq has bit r set iff
+// the character matches row r, and hin is the difference between the new & old score of the row above the block;
+// return the difference between the new & old score of the last row of the block
+inline int myers_block(uint64_t& vp, uint64_t& vn, uint64_t eq, const int hin)
+{
+  const uint64_t xv = eq | vn;
+  if(hin < 0) eq |= 1;
+  const uint64_t xh = (((eq & vp) + vp) ^ vp) | eq;
+  uint64_t ph = vn | ~(xh | vp);
+  uint64_t mh = vp & xh;
+  const int hout = (ph >> 63) ? 1 : ((mh >> 63) ? -1 : 0);
+  ph <<= 1;
+  mh <<= 1;
+  if(hin < 0) mh |= 1; else if(hin > 0) ph |= 1;
+  vp = mh | ~(xv | ph);
+  vn = ph & xv;
+  return hout;
+}
+
+//! the modified Levenstein distance of modified_levenstein_distance() (see below), computed with bit-vectors
+/** Reversing both sequences turns the free suffixes into free prefixes, that is, into a DP table whose first row
+ * and column are all 0. Each column of this table (one row per character of the reversed s1[lower_index:]) is
+ * kept as bit-vectors of the +1/-1 differences between consecutive rows, in (len1 + 63) / 64 words, and each
+ * character of s2 advances it with a few word operations per block. The results are the last column.
+ */
+inline std::vector<unsigned> bitparallel_levenstein_distance(const std::string& s1,
+                                                            const std::string& s2,
+                                                            const size_t lower_index,
+                                                            const size_t upper_index)
+{
+  assert(upper_index >= lower_index);
+  assert(upper_index <= s1.length());
+  const size_t len1 = s1.length() - lower_index;
+  const size_t window = upper_index - lower_index;
+  const size_t blocks = (len1 + 63) / 64;
+  DEBUG5(std::cout << "computing bit-parallel shifted Levenstein distances for strings of length "<<len1<<" and "<<s2.length()<<std::endl);
+
+  // peq[c * blocks + b] has bit r set iff the reversed s1[lower_index:] has character c at position 64 * b + r
+  std::vector<uint64_t> peq(256 * blocks, 0);
+  for(size_t r = 0; r < len1; ++r)
+    peq[(unsigned char)s1[s1.length() - 1 - r] * blocks + r / 64] |= uint64_t(1) << (r % 64);
+
+  std::vector<uint64_t> vp(blocks, 0), vn(blocks, 0);
+  for(size_t j = s2.length(); j-- > 0;){
+    const uint64_t* const eq = peq.data() + (unsigned char)s2[j] * blocks;
+    int h = 0;
+    for(size_t b = 0; b < blocks; ++b) h = myers_block(vp[b], vn[b], eq[b], h);
+  }
+
+  // row r of the last column is the distance of s1[lower_index + len1 - r:] & s2
+  std::vector<unsigned> result(window);
+  unsigned score = 0;
+  for(size_t r = 1; r <= len1; ++r){
+    score += ((vp[(r - 1) / 64] >> ((r - 1) % 64)) & 1);
+    score -= ((vn[(r - 1) / 64] >> ((r - 1) % 64)) & 1);
+    if(len1 - r < window) result[len1 - r] = score;
+  }
+  return result;
+}
+
+//! bitparallel_levenstein_distance(s1, s2, 0, s1.length()) for each s1 in patterns, with a single pass over s2
+/** Patterns of at most 64 characters are packed next to each other into 64-bit words; carries & shifts are kept
+ * from crossing from one pattern into the next, so each word compares s2 to all of its patterns at once.
+ * Longer patterns are compared one at a time.
+ */
+inline std::vector<std::vector<unsigned>> bitparallel_levenstein_distances(const std::vector<std::string>& patterns,
+                                                                          const std::string& s2)
+{
+  std::vector<std::vector<unsigned>> result(patterns.size());
+  // the packed patterns: the word of each pattern and the position of its first row in the word
+  std::vector<std::pair<size_t, unsigned>> lane(patterns.size());
+  std::vector<uint64_t> starts, tops; // the first & last rows of the patterns in each word
+  unsigned used = 64;
+  for(size_t p = 0; p < patterns.size(); ++p){
+    const size_t len = patterns[p].length();
+    if(len > 64){
+      result[p] = bitparallel_levenstein_distance(patterns[p], s2, 0, len);
+      continue;
+    } else if(len == 0) continue;
+    if(used + len > 64){
+      starts.push_back(0);
+      tops.push_back(0);
+      used = 0;
+    }
+    lane[p] = {starts.size() - 1, used};
+    starts.back() |= uint64_t(1) << used;
+    tops.back() |= uint64_t(1) << (used + len - 1);
+    used += len;
+  }
+  const size_t words = starts.size();
+
+  // peq[c * words + w] has bit r set iff row r of word w matches the character c
+  std::vector<uint64_t> peq(256 * words, 0);
+  for(size_t p = 0; p < patterns.size(); ++p){
+    const std::string& s1 = patterns[p];
+    if(s1.empty() || (s1.length() > 64)) continue;
+    for(size_t r = 0; r < s1.length(); ++r)
+      peq[(unsigned char)s1[s1.length() - 1 - r] * words + lane[p].first] |= uint64_t(1) << (lane[p].second + r);
+  }
+
+  std::vector<uint64_t> vp(words, 0), vn(words, 0);
+  for(size_t j = s2.length(); j-- > 0;){
+    const uint64_t* const eq_word = peq.data() + (unsigned char)s2[j] * words;
+    for(size_t w = 0; w < words; ++w){
+      const uint64_t eq = eq_word[w];
+      const uint64_t xv = eq | vn[w];
+      // (eq & vp) + vp without carries out of the last row of any pattern
+      const uint64_t x = eq & vp[w];
+      const uint64_t sum = ((x & ~tops[w]) + (vp[w] & ~tops[w])) ^ ((x ^ vp[w]) & tops[w]);
+      const uint64_t xh = (sum ^ vp[w]) | eq;
+      // the first row of each pattern is below the all-0 first row of its table, so nothing is shifted into it
+      const uint64_t ph = ((vn[w] | ~(xh | vp[w])) << 1) & ~starts[w];
+      const uint64_t mh = ((vp[w] & xh) << 1) & ~starts[w];
+      vp[w] = mh | ~(xv | ph);
+      vn[w] = ph & xv;
+    }
+  }
+
+  for(size_t p = 0; p < patterns.size(); ++p){
+    const size_t len = patterns[p].length();
+    if(len == 0 || len > 64) continue;
+    result[p].resize(len);
+    unsigned score = 0;
+    for(size_t r = 1; r <= len; ++r){
+      const unsigned bit = lane[p].second + r - 1;
+      score += (vp[lane[p].first] >> bit) & 1;
+      score -= (vn[lane[p].first] >> bit) & 1;
+      result[p][len - r] = score;
+    }
+  }
+  return result;
+}
+
 //! modified Levenstein distance of an alignment of two sequences
 /** this Levenstein distance is modified to absorb any suffix of s1 or s2 at no cost, as it will be used to
  * find alignments of sub-sequences and we don't want to punish the fact that one of the sequences may be shorter.
@@ -89,7 +245,7 @@ typedef std::vector2d<Op> Levenstein_Op_Table;
  *
  * NOTE: this is a modification of https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C.2B.2B
  */
-std::vector<unsigned> modified_levenstein_distance(const std::string& s1,
+inline std::vector<unsigned> modified_levenstein_distance(const std::string& s1,
                                                    const std::string& s2,
                                                    const size_t lower_index,
                                                    const size_t upper_index,
@@ -97,6 +253,8 @@ std::vector<unsigned> modified_levenstein_distance(const std::string& s1,
 {
   assert(upper_index >= lower_index);
   assert(upper_index <= s1.length());
+  // without operations table, the bit-parallel version computes the same distances in linear space
+  if(!op_table) return bitparallel_levenstein_distance(s1, s2, lower_index, upper_index);
   const ssize_t len1 = s1.length() - lower_index;
   const ssize_t len2 = s2.length();
   const ssize_t window = upper_index - lower_index;
@@ -142,13 +300,13 @@ std::vector<unsigned> modified_levenstein_distance(const std::string& s1,
 }
 
 //! a simple char consensus; This can be used if some transitions are more likely than others
-char char_consensus(const char& x, const char& y)
+inline char char_consensus(const char& x, const char& y)
 {
   return x;
 }
 
 //! retrace an operations table for a Levenstein-distance computation, producting the implied consensus
-std::string levenstein_consensus(const std::string& s1, const std::string& s2, const unsigned s2_offset, const Levenstein_Op_Table& op_table)
+inline std::string levenstein_consensus(const std::string& s1, const std::string& s2, const unsigned s2_offset, const Levenstein_Op_Table& op_table)
 {
   std::string result;
   const size_t len1 = op_table.size().first - 1;
@@ -166,7 +324,7 @@ std::string levenstein_consensus(const std::string& s1, const std::string& s2, c
         ++j;
         break;
       case CHANGE:
-        result += char_consensus(s1[i], s2[j + s2_offset]);
+        result += char_consensus(s1[i], s2[j]);
         ++i;
         ++j;
         break;
@@ -180,6 +338,134 @@ std::string levenstein_consensus(const std::string& s1, const std::string& s2, c
   return result;
 }
 
+//! the consensus levenstein_consensus() computes for the op table of modified_levenstein_distance(s1, s2, lower_index, ...),
+//! without the op table
+/** Hirschberg-style: the table of modified_levenstein_distance() is computed from its last row upwards, so the rows
+ * [top, bottom) of the trace are handled by computing row mid = (top + bottom) / 2 from row bottom, tracing the rows
+ * [top, mid) recursively and then the rows [mid, bottom). Blocks of up to CONSENSUS_BLOCK_CELLS cells are traced
+ * directly. This keeps O(len2 * log(len1)) numbers instead of len1 * len2 ops, for O(log(len1)) times the work.
+ * While the upper half is traced, another thread already computes the middle row of the lower half, using up to
+ * 'threads' threads at once.
+ */
+class LinearLevensteinConsensus
+{
+  typedef std::vector<unsigned> Row; // the cells d[{i, j}] of a row i of the table, valid for all j >= first column
+
+  const std::string& s1;
+  const std::string& s2;
+  const size_t lower_index;
+  const unsigned s2_offset;
+  const size_t len1;
+  const size_t len2;
+  size_t i, j; // the current cell of the trace
+  std::string result;
+
+  // compute row i from row i + 1 (below) for the columns first, ..., len2
+  void compute_row(const size_t row_index, const Row& below, Row& row, const size_t first) const
+  {
+    row[len2] = 0;
+    for(size_t col = len2; col-- > first;){
+      const unsigned del1_cost = below[col] + 1;
+      const unsigned del2_cost = row[col + 1] + 1;
+      const unsigned change_cost = below[col + 1] + (s1[row_index + lower_index] == s2[col] ? 0 : 1);
+      row[col] = std::min(change_cost, std::min(del1_cost, del2_cost));
+    }
+  }
+
+  // compute row 'target' from row bottom for the columns first, ..., len2
+  Row compute_rows(const size_t bottom, const size_t target, const Row& bottom_row, const size_t first) const
+  {
+    Row row(bottom_row), above(len2 + 1);
+    for(size_t r = bottom; r-- > target;){
+      compute_row(r, row, above, first);
+      row.swap(above);
+    }
+    return row;
+  }
+
+  // follow the op of the current cell, as stored by modified_levenstein_distance(), given its row & the row below
+  void step(const Row& row, const Row& below)
+  {
+    const unsigned del1_cost = below[j] + 1;
+    const unsigned del2_cost = row[j + 1] + 1;
+    const unsigned change_cost = below[j + 1] + (s1[i + lower_index] == s2[j] ? 0 : 1);
+    Op op;
+    if(del1_cost < del2_cost)
+      op = (change_cost < del1_cost) ? CHANGE : DEL_LEFT;
+    else
+      op = (change_cost < del2_cost) ? CHANGE : DEL_RIGHT;
+    switch(op){
+      case DEL_LEFT:
+        ++i;
+        break;
+      case DEL_RIGHT:
+        ++j;
+        break;
+      default:
+        result += char_consensus(s1[i], s2[j]);
+        ++i;
+        ++j;
+    }
+  }
+
+  // trace the rows i, ..., bottom - 1 given row bottom (& row (i + bottom) / 2, if known); return false if the trace ends
+  bool trace(const size_t bottom, const Row& bottom_row, const Row* mid_row, const unsigned threads)
+  {
+    const size_t top = i;
+    const size_t width = len2 + 1;
+    if((bottom - top < 2) || ((bottom - top) * width <= CONSENSUS_BLOCK_CELLS)){
+      std::vector<Row> rows(bottom - top + 1, Row(width));
+      rows.back() = bottom_row;
+      for(size_t r = bottom; r-- > top;) compute_row(r, rows[r + 1 - top], rows[r - top], j);
+      while((i < bottom) && (j < len2)) step(rows[i - top], rows[i + 1 - top]);
+      return j < len2;
+    }
+
+    const size_t mid = (top + bottom) / 2;
+    Row computed_mid;
+    if(!mid_row){
+      computed_mid = compute_rows(bottom, mid, bottom_row, j);
+      mid_row = &computed_mid;
+    }
+    // the middle row of the lower half, computed while the upper half is traced
+    const size_t lower_mid = (mid + bottom) / 2;
+    Row lower_mid_row;
+    bool keep_going;
+    if((threads > 1) && ((bottom - mid) * width > CONSENSUS_BLOCK_CELLS)){
+      const size_t first = j;
+      std::thread lower([&]{ lower_mid_row = compute_rows(bottom, lower_mid, bottom_row, first); });
+      keep_going = trace(mid, *mid_row, NULL, threads - 1);
+      lower.join();
+    } else keep_going = trace(mid, *mid_row, NULL, threads);
+    if(!keep_going) return false;
+    return trace(bottom, bottom_row, lower_mid_row.empty() ? NULL : &lower_mid_row, threads);
+  }
+
+public:
+  LinearLevensteinConsensus(const std::string& _s1, const std::string& _s2, const size_t _lower_index, const unsigned _s2_offset):
+    s1(_s1), s2(_s2), lower_index(_lower_index), s2_offset(_s2_offset),
+    len1(_s1.length() - _lower_index), len2(_s2.length()),
+    i(_s2_offset), j(0)
+  {
+    assert(i <= len1);
+  }
+
+  std::string operator()(const unsigned threads = 1)
+  {
+    if((i < len1) && (j < len2)) trace(len1, Row(len2 + 1, 0), NULL, threads);
+    if(i == len1) result += s2.substr(j);
+    if(j == len2) result += s1.substr(i);
+    return result;
+  }
+};
+
+//! levenstein_consensus(s1, s2, s2_offset, op_table) for the op_table of modified_levenstein_distance(s1, s2, lower_index, ...)
+inline std::string linear_levenstein_consensus(const std::string& s1, const std::string& s2, const size_t lower_index,
+                                               const unsigned s2_offset, const unsigned threads = 1)
+{
+  return LinearLevensteinConsensus(s1, s2, lower_index, s2_offset)(threads);
+}
+
 
 
 
@@ -190,7 +476,7 @@ std::string levenstein_consensus(const std::string& s1, const std::string& s2, c
 /** This functions segfaults for reasons that are beyond me...
  * For now, use the non-segfaulting "merge_strings()" below
  */
-std::string merge_strings_segfault(const std::string& seq1,
+inline std::string merge_strings_segfault(const std::string& seq1,
                             const std::string& seq2,
                             const unsigned overlap)
 {
@@ -220,7 +506,7 @@ std::string merge_strings_segfault(const std::string& seq1,
 //! merge two sequences seq1 and seq2 with overlap "overlap" according to their order
 /** For example: merge_strings("abcde", "1234", 3) = "ab1234"
  */
-std::string merge_strings(const std::string& seq1,
+inline std::string merge_strings(const std::string& seq1,
                             const std::string& seq2,
                             const unsigned overlap)
 {
@@ -0,0 +1,198 @@
+
+//! file subsample.hpp
+/** Families of sub-instances (subsets of the species, windows of the characters) of one alignment:
+ * the alignment is parsed once and each species is turned into a bitmask over the vertices (character, state)
+ * of all characters, ordered by character. The vertices of a character window then form a contiguous range of
+ * bits, and the neighborhood of a vertex v in a sub-instance is the OR of the masks of the chosen species that
+ * contain v, restricted to the characters that are informative among the chosen species.
+ * A sub-instance is the graph that add_species_cliques() builds for the sub-alignment, so its vertices are numbered
+ * consecutively in order of their first occurrence; with the species in sub_alignment_order(), it is exactly the
+ * instance converted from a fasta file containing only the chosen records & characters.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <random>
+#include <numeric>
+#include <cstdint>
+#include <algorithm>
+#include "utils/utils.hpp"
+#include "utils/graph.hpp"
+#include "utils/sequences.hpp"
+
+// a sub-instance, given by its species (indices into the matrix) and the characters first_char, ..., end_char - 1
+struct SubInstanceSpec
+{
+  std::string description;
+  std::vector<unsigned> species;
+  size_t first_char = 0;
+  size_t end_char = -1;
+};
+
+//! return k species out of n drawn uniformly at random (using the given seed), in increasing order
+inline std::vector<unsigned> random_species_subset(const size_t n, const size_t k, const unsigned seed)
+{
+  assert(k <= n);
+  std::mt19937 rng(seed);
+  std::vector<unsigned> result(n);
+  std::iota(result.begin(), result.end(), 0);
+  // partial Fisher-Yates shuffle
+  for(size_t i = 0; i < k; ++i)
+    std::swap(result[i], result[std::uniform_int_distribution<size_t>(i, n - 1)(rng)]);
+  result.resize(k);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+//! order the species (indices into the matrix) canonically, as ma_to_cc orders the records of their sub-alignment
+//! on the characters first_char, ..., end_char - 1: by their sequences on these characters, then by their names
+inline std::vector<unsigned> sub_alignment_order(std::vector<unsigned> species, const CharMatrix& matrix,
+                                                 const std::vector<std::string>& names, const size_t first_char, size_t end_char)
+{
+  end_char = std::min(end_char, matrix.size().second);
+  std::sort(species.begin(), species.end(), [&](const unsigned a, const unsigned b){
+      for(size_t ch = first_char; ch < end_char; ++ch){
+        const unsigned char x = matrix[{a, ch}], y = matrix[{b, ch}];
+        if(x != y) return x < y;
+      }
+      return names[a] < names[b];
+    });
+  return species;
+}
+
+// the vertices (character, state) of all characters of an (unreduced) matrix, numbered by character and,
+// within each character, in order of the first occurrence of the state
+class CharacterStates
+{
+public:
+  typedef Graph::Vertex Vertex;
+
+protected:
+  const CharMatrix& matrix;
+  const size_t num_species;
+  const size_t num_chars;
+  std::vector<Vertex> column_begin;     // the vertices of character ch are column_begin[ch], ..., column_begin[ch + 1] - 1
+  std::vector<Graph::VertexName> names; // the name of each vertex
+  std::vector<Vertex> vertex_of;        // the vertex of each (species, character), stored character by character
+
+public:
+  CharacterStates(const CharMatrix& _matrix):
+    matrix(_matrix),
+    num_species(_matrix.empty() ? 0 : _matrix.size().first),
+    num_chars(_matrix.empty() ? 0 : _matrix.size().second),
+    column_begin(1, 0),
+    vertex_of(num_species * num_chars)
+  {
+    std::vector<char> states;
+    for(size_t ch = 0; ch < num_chars; ++ch){
+      states.clear();
+      for(size_t species = 0; species < num_species; ++species){
+        const char state = matrix[{species, ch}];
+        const size_t index = std::find(states.begin(), states.end(), state) - states.begin();
+        if(index == states.size()){
+          states.push_back(state);
+          names.emplace_back(ch, state);
+        }
+        vertex_of[ch * num_species + species] = column_begin.back() + index;
+      }
+      column_begin.push_back(column_begin.back() + states.size());
+    }
+  }
+
+  size_t num_vertices() const { return names.size(); }
+  size_t num_characters() const { return num_chars; }
+  size_t num_states(const size_t ch) const { return column_begin[ch + 1] - column_begin[ch]; }
+  Vertex first_vertex(const size_t ch) const { return column_begin[ch]; }
+  Vertex vertex(const unsigned species, const size_t ch) const { return vertex_of[ch * num_species + species]; }
+  const Graph::VertexName& name(const Vertex v) const { return names[v]; }
+
+  //! whether the character is informative among the given species, as IsolateSNIPs() decides for their sub-alignment
+  template<typename SpeciesList>
+  bool is_informative(const size_t ch, const SpeciesList& species) const
+  {
+    const char first_state = matrix[{species[0], ch}];
+    if(first_state == '-') return false;
+    for(const unsigned s: species)
+      if(matrix[{s, ch}] != first_state) return true;
+    return false;
+  }
+};
+
+class SpeciesMasks: public CharacterStates
+{
+protected:
+  size_t words = 0;                     // number of 64-bit words per mask
+  std::vector<uint64_t> masks;          // the vertices of each species
+
+  static bool test(const uint64_t* r, const size_t i) { return (r[i / 64] >> (i % 64)) & 1; }
+  static void set(uint64_t* r, const size_t i) { r[i / 64] |= uint64_t(1) << (i % 64); }
+  static void set_range(uint64_t* r, size_t first, const size_t end) { for(; first < end; ++first) set(r, first); }
+
+  const uint64_t* mask(const unsigned species) const { return masks.data() + species * words; }
+
+public:
+  SpeciesMasks(const CharMatrix& _matrix):
+    CharacterStates(_matrix),
+    words((names.size() + 63) / 64),
+    masks(num_species * words, 0)
+  {
+    for(size_t ch = 0; ch < num_chars; ++ch)
+      for(size_t species = 0; species < num_species; ++species)
+        set(masks.data() + species * words, vertex(species, ch));
+    DEBUG2(std::cout << "computed masks of "<<num_species<<" species over "<<names.size()<<" vertices"<<std::endl);
+  }
+
+  //! return the intersection graph of the given species (in this order) on the characters first_char, ..., end_char - 1
+  /** if characters_kept is given, it receives the number of characters that are informative among the species **/
+  Graph sub_instance(const std::vector<unsigned>& species, const size_t first_char, size_t end_char, size_t* characters_kept = NULL) const
+  {
+    end_char = std::min(end_char, num_chars);
+    if(characters_kept) *characters_kept = 0;
+    if(species.empty() || (first_char >= end_char)) return Graph();
+    const size_t first_word = column_begin[first_char] / 64;
+    const size_t end_word = (column_begin[end_char] + 63) / 64;
+
+    // the vertices of the informative characters, as IsolateSNIPs() computes them for the sub-alignment
+    std::vector<uint64_t> informative(words, 0);
+    for(size_t ch = first_char; ch < end_char; ++ch)
+      if(is_informative(ch, species)){
+        set_range(informative.data(), column_begin[ch], column_begin[ch + 1]);
+        if(characters_kept) ++*characters_kept;
+      }
+
+    // number the vertices in order of their first occurrence, as add_species_cliques() does
+    const Vertex none = -1;
+    std::vector<Vertex> local(num_vertices(), none);
+    std::vector<Vertex> global;
+    for(const unsigned s: species)
+      for(size_t ch = first_char; ch < end_char; ++ch){
+        const Vertex v = vertex(s, ch);
+        if(test(informative.data(), v) && (local[v] == none)){
+          local[v] = global.size();
+          global.push_back(v);
+        }
+      }
+
+    Graph result(global.size());
+    std::vector<uint64_t> row(words);
+    for(Vertex i = 0; i < global.size(); ++i){
+      const Vertex v = global[i];
+      result.set_name(i, names[v]);
+      std::fill(row.begin() + first_word, row.begin() + end_word, 0);
+      for(const unsigned s: species){
+        const uint64_t* const m = mask(s);
+        if(test(m, v))
+          for(size_t w = first_word; w < end_word; ++w) row[w] |= m[w];
+      }
+      for(size_t w = first_word; w < end_word; ++w)
+        for(uint64_t bits = row[w] & informative[w]; bits; bits &= bits - 1){
+          const Vertex u = local[w * 64 + __builtin_ctzll(bits)];
+          if(u < i) result.add_edge(i, u);
+        }
+    }
+    return result;
+  }
+};
+
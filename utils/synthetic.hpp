@@ -0,0 +1,74 @@
+
+//! file synthetic.hpp
+/** generators for synthetic inputs (alignments & edge lists), used for benchmarking
+ * Species are organized in clusters: each cluster mutates a common root sequence and each species
+ * mutates its cluster's sequence, so the amount of state sharing can be controlled by the number
+ * of clusters and the mutation rates.
+ **/
+
+#pragma once
+
+#include <random>
+#include <string>
+#include <sstream>
+#include "utils/sequences.hpp"
+
+#define SYNTHETIC_LINE_LENGTH 60
+// the states are the letters of BASES; its last symbols ('*' & '-') are not states
+#define SYNTHETIC_MAX_ALPHABET 26
+
+struct SyntheticAlignmentParams
+{
+  unsigned species = 50;
+  unsigned characters = 1000;
+  unsigned alphabet = 4;           // number of states (taken from BASES), at most SYNTHETIC_MAX_ALPHABET
+  double gap_rate = 0.02;          // probability of a gap ('-') per species & character
+  unsigned clusters = 4;           // number of groups of species sharing a cluster sequence
+  double cluster_mutation = 0.1;   // probability that a cluster sequence differs from the root per character
+  double species_mutation = 0.05;  // probability that a species differs from its cluster sequence per character
+  unsigned seed = 0;
+};
+
+//! generate a random alignment in fasta format with the given parameters
+inline std::string synthetic_alignment(const SyntheticAlignmentParams& p)
+{
+  std::mt19937 rng(p.seed);
+  std::uniform_int_distribution<unsigned> random_state(0, std::max(p.alphabet, 1u) - 1);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  const auto mutate = [&](const std::string& s, const double rate){
+    std::string result(s);
+    for(char& c: result) if(coin(rng) < rate) c = BASES[random_state(rng)];
+    return result;
+  };
+
+  std::string root(p.characters, 'A');
+  for(char& c: root) c = BASES[random_state(rng)];
+  std::vector<std::string> cluster_seqs;
+  for(unsigned i = 0; i < std::max(p.clusters, 1u); ++i)
+    cluster_seqs.push_back(mutate(root, p.cluster_mutation));
+
+  std::ostringstream out;
+  for(unsigned s = 0; s < p.species; ++s){
+    std::string seq = mutate(cluster_seqs[s % cluster_seqs.size()], p.species_mutation);
+    for(char& c: seq) if(coin(rng) < p.gap_rate) c = '-';
+    out << ">species" << s << std::endl;
+    for(size_t pos = 0; pos < seq.length(); pos += SYNTHETIC_LINE_LENGTH)
+      out << seq.substr(pos, SYNTHETIC_LINE_LENGTH) << std::endl;
+  }
+  return out.str();
+}
+
+//! generate a random edge list with (at most) num_edges distinct edges on num_vertices vertices
+inline std::string synthetic_edgelist(const unsigned num_vertices, const size_t num_edges, const unsigned seed = 0)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<unsigned> random_vertex(0, num_vertices - 1);
+  std::ostringstream out;
+  for(size_t i = 0; i < num_edges; ++i){
+    const unsigned u = random_vertex(rng);
+    const unsigned v = random_vertex(rng);
+    if(u != v) out << u << " " << v << '\n';
+  }
+  return out.str();
+}
+
@@ -0,0 +1,204 @@
+
+//! file thread_pool.hpp
+/** A small work-stealing thread pool:
+ * each worker owns a deque of tasks, taking tasks from its front and, when it runs dry,
+ * stealing from the back of the other workers' deques. Tasks submitted from inside a worker
+ * go to that worker's own deque, other tasks are distributed round-robin.
+ * Tasks should not throw; catch exceptions inside the task and report them otherwise.
+ * Also contains a memory budget that tasks can reserve memory from before they allocate.
+ **/
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+class ThreadPool
+{
+public:
+  typedef std::function<void()> Task;
+
+protected:
+  struct WorkQueue
+  {
+    std::deque<Task> tasks;
+    std::mutex lock;
+  };
+
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> threads;
+  std::mutex state_lock;
+  std::condition_variable work_available;
+  std::condition_variable all_done;
+  size_t pending = 0;      // number of tasks submitted but not finished
+  size_t queued = 0;       // number of tasks waiting in some queue
+  size_t next_queue = 0;   // round-robin counter for external submissions
+  bool stopping = false;
+
+  // index of the worker running on the current thread (or -1 if the thread is not a worker of any pool)
+  static size_t& current_worker()
+  {
+    static thread_local size_t index = -1;
+    return index;
+  }
+
+  bool pop_front(const size_t q, Task& task)
+  {
+    std::lock_guard<std::mutex> guard(queues[q]->lock);
+    if(queues[q]->tasks.empty()) return false;
+    task = std::move(queues[q]->tasks.front());
+    queues[q]->tasks.pop_front();
+    return true;
+  }
+
+  bool steal(const size_t thief, Task& task)
+  {
+    for(size_t i = 1; i < queues.size(); ++i){
+      WorkQueue& victim = *queues[(thief + i) % queues.size()];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if(!victim.tasks.empty()){
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run_worker(const size_t index)
+  {
+    current_worker() = index;
+    while(true){
+      Task task;
+      if(pop_front(index, task) || steal(index, task)){
+        {
+          std::lock_guard<std::mutex> guard(state_lock);
+          --queued;
+        }
+        task();
+        std::lock_guard<std::mutex> guard(state_lock);
+        if(--pending == 0) all_done.notify_all();
+      } else {
+        std::unique_lock<std::mutex> guard(state_lock);
+        work_available.wait(guard, [this]{ return stopping || (queued > 0); });
+        if(stopping && (queued == 0)) return;
+      }
+    }
+  }
+
+public:
+
+  ThreadPool(const unsigned num_threads = std::thread::hardware_concurrency())
+  {
+    const unsigned n = std::max(num_threads, 1u);
+    for(unsigned i = 0; i < n; ++i) queues.emplace_back(new WorkQueue());
+    for(unsigned i = 0; i < n; ++i) threads.emplace_back(&ThreadPool::run_worker, this, i);
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> guard(state_lock);
+      stopping = true;
+    }
+    work_available.notify_all();
+    for(auto& t: threads) t.join();
+  }
+
+  size_t num_threads() const
+  {
+    return threads.size();
+  }
+
+  void submit(Task task)
+  {
+    const size_t me = current_worker();
+    size_t q;
+    {
+      std::lock_guard<std::mutex> guard(state_lock);
+      ++pending;
+      ++queued;
+      q = (me < queues.size()) ? me : (next_queue++ % queues.size());
+    }
+    {
+      std::lock_guard<std::mutex> guard(queues[q]->lock);
+      queues[q]->tasks.push_back(std::move(task));
+    }
+    work_available.notify_one();
+  }
+
+  //! block until all submitted tasks have finished
+  /** NOTE: do not call this from inside a task **/
+  void wait()
+  {
+    std::unique_lock<std::mutex> guard(state_lock);
+    all_done.wait(guard, [this]{ return pending == 0; });
+  }
+
+  //! run f(i) for all i in [0, n) on the pool and wait for all of them to finish
+  template<typename Function>
+  void parallel_for(const size_t n, Function f)
+  {
+    for(size_t i = 0; i < n; ++i) submit([f, i]{ f(i); });
+    wait();
+  }
+};
+
+
+//! a budget of bytes that tasks reserve before allocating a lot of memory
+/** a reservation blocks until enough of the budget is free. Reservations that exceed the whole budget
+ * are granted as soon as nothing else is reserved, so they run alone instead of waiting forever.
+ **/
+class MemoryBudget
+{
+protected:
+  const size_t total;
+  size_t reserved = 0;
+  std::mutex lock;
+  std::condition_variable released;
+
+public:
+  MemoryBudget(const size_t _total): total(_total) {}
+
+  //! reserve 'bytes' bytes, return the amount that has actually been reserved (to be passed to release())
+  size_t reserve(size_t bytes)
+  {
+    bytes = std::min(bytes, total);
+    std::unique_lock<std::mutex> guard(lock);
+    released.wait(guard, [&]{ return reserved + bytes <= total; });
+    reserved += bytes;
+    return bytes;
+  }
+
+  void release(const size_t bytes)
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      reserved -= bytes;
+    }
+    released.notify_all();
+  }
+};
+
+// reserve memory from a budget for the lifetime of the object
+class MemoryReservation
+{
+  MemoryBudget& budget;
+  const size_t bytes;
+public:
+  MemoryReservation(MemoryBudget& _budget, const size_t _bytes):
+    budget(_budget), bytes(_budget.reserve(_bytes))
+  {}
+  ~MemoryReservation()
+  {
+    budget.release(bytes);
+  }
+};
+
@@ -0,0 +1,315 @@
+
+//! file treewidth.hpp
+/** Bounds on the treewidth and the minimum fill-in of a graph, used to classify the difficulty of instances:
+ * - upper bounds by the greedy elimination heuristics min-degree and min-fill
+ *   (the width of the elimination ordering bounds the treewidth, its number of fill edges the minimum fill-in)
+ * - a lower bound on the treewidth by minor-min-width (contract a min-degree vertex into its min-degree neighbor)
+ * All of them work on a dense bit matrix with 64-bit rows, so merging neighborhoods and counting common
+ * neighbors are word operations (which the compiler vectorizes with -march=native).
+ * min-fill keeps the number of edges in each neighborhood (triangles) up to date instead of recounting the
+ * fill of all vertices around the eliminated one; counting the triangles of the new fill edges can be
+ * distributed over a thread pool.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "utils/utils.hpp"
+#include "utils/graph.hpp"
+#include "utils/thread_pool.hpp"
+
+// minimum number of fill edges of a single elimination that is worth distributing over threads
+#define TREEWIDTH_MIN_PARALLEL_FILL 4096
+
+// a graph on which vertices are eliminated (or contracted), stored as dense symmetric bit matrix without loops
+class EliminationGraph
+{
+public:
+  typedef Graph::Vertex Vertex;
+  typedef Graph::Edge Edge;
+
+protected:
+  const size_t n;
+  const size_t words;  // number of 64-bit words per row
+  std::vector<uint64_t> bits;
+  std::vector<size_t> deg;
+  std::vector<bool> alive;
+  size_t num_alive;
+
+public:
+  EliminationGraph(const Graph& g):
+    n(g.num_vertices()),
+    words((n + 63) / 64),
+    bits(n * words, 0),
+    deg(n, 0),
+    alive(n, true),
+    num_alive(n)
+  {
+    g.for_each_edge([this](const Vertex u, const Vertex v){ set(u, v); });
+    for(Vertex v = 0; v < n; ++v) deg[v] = count(row(v));
+  }
+
+  size_t num_vertices() const { return num_alive; }
+  size_t num_words() const { return words; }
+  size_t degree(const Vertex v) const { return deg[v]; }
+  bool is_alive(const Vertex v) const { return alive[v]; }
+
+  uint64_t* row(const Vertex v) { return bits.data() + v * words; }
+  const uint64_t* row(const Vertex v) const { return bits.data() + v * words; }
+
+  static bool test(const uint64_t* r, const size_t i) { return (r[i / 64] >> (i % 64)) & 1; }
+  bool test(const Vertex u, const Vertex v) const { return test(row(u), v); }
+  void set(const Vertex u, const Vertex v)
+  {
+    row(u)[v / 64] |= uint64_t(1) << (v % 64);
+    row(v)[u / 64] |= uint64_t(1) << (u % 64);
+  }
+  void reset(const Vertex u, const Vertex v)
+  {
+    row(u)[v / 64] &= ~(uint64_t(1) << (v % 64));
+    row(v)[u / 64] &= ~(uint64_t(1) << (u % 64));
+  }
+
+  size_t count(const uint64_t* r) const
+  {
+    size_t result = 0;
+    for(size_t i = 0; i < words; ++i) result += __builtin_popcountll(r[i]);
+    return result;
+  }
+  size_t count_common(const uint64_t* r1, const uint64_t* r2) const
+  {
+    size_t result = 0;
+    for(size_t i = 0; i < words; ++i) result += __builtin_popcountll(r1[i] & r2[i]);
+    return result;
+  }
+
+  //! call f(v) for each bit v set in the row r
+  template<typename Function>
+  void for_each_in(const uint64_t* r, Function f) const
+  {
+    for(size_t i = 0; i < words; ++i)
+      for(uint64_t w = r[i]; w; w &= w - 1) f(i * 64 + __builtin_ctzll(w));
+  }
+
+  //! call f(v) for each common neighbor v of the rows r1 & r2
+  template<typename Function>
+  void for_each_common(const uint64_t* r1, const uint64_t* r2, Function f) const
+  {
+    for(size_t i = 0; i < words; ++i)
+      for(uint64_t w = r1[i] & r2[i]; w; w &= w - 1) f(i * 64 + __builtin_ctzll(w));
+  }
+
+  //! return the neighbors of v
+  std::vector<Vertex> neighbors(const Vertex v) const
+  {
+    std::vector<Vertex> result;
+    result.reserve(deg[v]);
+    for_each_in(row(v), [&result](const Vertex u){ result.push_back(u); });
+    return result;
+  }
+
+  //! remove v from the graph (without making its neighborhood a clique)
+  void remove(const Vertex v)
+  {
+    for_each_in(row(v), [this, v](const Vertex u){ --deg[u]; });
+    const std::vector<Vertex> nbh = neighbors(v);
+    for(const Vertex u: nbh) reset(u, v);
+    deg[v] = 0;
+    alive[v] = false;
+    --num_alive;
+  }
+
+  //! return the pairs of non-adjacent neighbors of v, that is, the fill edges of eliminating v
+  std::vector<Edge> fill_edges(const Vertex v) const
+  {
+    std::vector<Edge> result;
+    const uint64_t* const r = row(v);
+    for_each_in(r, [&](const Vertex y){
+        const uint64_t* const ry = row(y);
+        // the neighbors z > y of v that are not adjacent to y
+        for(size_t i = y / 64; i < words; ++i){
+          uint64_t w = r[i] & ~ry[i];
+          if(i == y / 64) w &= ~((uint64_t(2) << (y % 64)) - 1);
+          for(; w; w &= w - 1) result.emplace_back(y, i * 64 + __builtin_ctzll(w));
+        }
+      });
+    return result;
+  }
+
+  //! add the edges, updating the degrees
+  void add_edges(const std::vector<Edge>& edges)
+  {
+    for(const Edge& e: edges){
+      set(e.first, e.second);
+      ++deg[e.first];
+      ++deg[e.second];
+    }
+  }
+
+  //! contract v into its neighbor u
+  void contract(const Vertex v, const Vertex u)
+  {
+    const std::vector<Vertex> nbh = neighbors(v);
+    remove(v);
+    for(const Vertex w: nbh)
+      if((w != u) && !test(u, w)){
+        set(u, w);
+        ++deg[u];
+        ++deg[w];
+      }
+  }
+};
+
+
+// the width & number of fill edges of an elimination ordering
+struct EliminationResult
+{
+  size_t width = 0;
+  size_t fill = 0;
+};
+
+//! eliminate vertices of minimum degree until the graph is empty
+inline EliminationResult min_degree_elimination(const Graph& g)
+{
+  EliminationGraph eg(g);
+  EliminationResult result;
+  while(eg.num_vertices()){
+    Graph::Vertex best = -1;
+    for(Graph::Vertex v = 0; v < g.num_vertices(); ++v)
+      if(eg.is_alive(v) && ((best == (Graph::Vertex)-1) || (eg.degree(v) < eg.degree(best)))) best = v;
+    result.width = std::max(result.width, eg.degree(best));
+    const std::vector<Graph::Edge> fill = eg.fill_edges(best);
+    result.fill += fill.size();
+    eg.remove(best);
+    eg.add_edges(fill);
+  }
+  return result;
+}
+
+//! eliminate vertices creating the least fill edges until the graph is empty
+/** for each vertex x, the number of edges between its neighbors (triangles containing x) is maintained;
+ * then the fill of x is deg(x)(deg(x)-1)/2 - triangles(x)
+ **/
+inline EliminationResult min_fill_elimination(const Graph& g, const unsigned threads = 1)
+{
+  typedef Graph::Vertex Vertex;
+  typedef Graph::Edge Edge;
+  const size_t n = g.num_vertices();
+  EliminationGraph eg(g);
+  std::vector<size_t> triangles(n, 0);
+  for(Vertex x = 0; x < n; ++x)
+    eg.for_each_in(eg.row(x), [&](const Vertex u){ triangles[x] += eg.count_common(eg.row(x), eg.row(u)); });
+  for(size_t& t: triangles) t /= 2;
+  const auto fill_of = [&](const Vertex x){ return eg.degree(x) * (eg.degree(x) - 1) / 2 - triangles[x]; };
+
+  std::unique_ptr<ThreadPool> pool(threads > 1 ? new ThreadPool(threads) : NULL);
+  std::vector<std::vector<size_t>> local_triangles(threads);
+  // for the new edges of v's neighborhood, the old rows of v's neighbors are needed
+  std::vector<size_t> nbh_index(n, -1);
+  std::vector<uint64_t> old_rows;
+
+  EliminationResult result;
+  while(eg.num_vertices()){
+    Vertex v = -1;
+    size_t best_fill = -1;
+    for(Vertex x = 0; x < n; ++x)
+      if(eg.is_alive(x)){
+        const size_t f = fill_of(x);
+        if((f < best_fill) || ((f == best_fill) && (eg.degree(x) < eg.degree(v)))){
+          v = x;
+          best_fill = f;
+        }
+      }
+    const std::vector<Vertex> nbh = eg.neighbors(v);
+    result.width = std::max(result.width, nbh.size());
+    const std::vector<Edge> fill = eg.fill_edges(v);
+    result.fill += fill.size();
+
+    // step 1: remove v and the triangles containing it
+    for(const Vertex x: nbh) triangles[x] -= eg.count_common(eg.row(x), eg.row(v));
+    eg.remove(v);
+    if(fill.empty()) continue;
+
+    // step 2: add the fill edges and count the new triangles; a triangle may contain up to 3 new edges,
+    //         so it is only counted for its smallest new edge
+    const size_t words = eg.num_words();
+    old_rows.resize(nbh.size() * words);
+    for(size_t i = 0; i < nbh.size(); ++i){
+      nbh_index[nbh[i]] = i;
+      std::copy(eg.row(nbh[i]), eg.row(nbh[i]) + words, old_rows.begin() + i * words);
+    }
+    eg.add_edges(fill);
+    const auto is_new = [&](const Vertex a, const Vertex b){
+        return (nbh_index[a] != (size_t)-1) && (nbh_index[b] != (size_t)-1) && !EliminationGraph::test(old_rows.data() + nbh_index[a] * words, b);
+      };
+    const auto count_triangles = [&](const size_t from, const size_t to, std::vector<size_t>& tri){
+        for(size_t i = from; i < to; ++i){
+          const Edge& e = fill[i];
+          eg.for_each_common(eg.row(e.first), eg.row(e.second), [&](const Vertex w){
+              const Edge e1(std::min(e.first, w), std::max(e.first, w));
+              const Edge e2(std::min(e.second, w), std::max(e.second, w));
+              if((is_new(e1.first, e1.second) && (e1 < e)) || (is_new(e2.first, e2.second) && (e2 < e))) return;
+              ++tri[e.first];
+              ++tri[e.second];
+              ++tri[w];
+            });
+        }
+      };
+    if(pool && (fill.size() >= TREEWIDTH_MIN_PARALLEL_FILL)){
+      const size_t chunk = (fill.size() + threads - 1) / threads;
+      pool->parallel_for(threads, [&](const size_t t){
+          local_triangles[t].assign(n, 0);
+          count_triangles(std::min(t * chunk, fill.size()), std::min((t + 1) * chunk, fill.size()), local_triangles[t]);
+        });
+      for(const std::vector<size_t>& tri: local_triangles)
+        for(Vertex x = 0; x < n; ++x) triangles[x] += tri[x];
+    } else count_triangles(0, fill.size(), triangles);
+    for(const Vertex x: nbh) nbh_index[x] = -1;
+  }
+  return result;
+}
+
+//! lower bound on the treewidth: contract a vertex of minimum degree into its neighbor of minimum degree until the graph is empty,
+//! the maximum of the minimum degrees is a lower bound
+inline size_t minor_min_width(const Graph& g)
+{
+  EliminationGraph eg(g);
+  size_t result = 0;
+  while(eg.num_vertices() > 1){
+    Graph::Vertex v = -1;
+    for(Graph::Vertex x = 0; x < g.num_vertices(); ++x)
+      if(eg.is_alive(x) && ((v == (Graph::Vertex)-1) || (eg.degree(x) < eg.degree(v)))) v = x;
+    result = std::max(result, eg.degree(v));
+    if(eg.degree(v) == 0){
+      eg.remove(v);
+      continue;
+    }
+    Graph::Vertex u = -1;
+    eg.for_each_in(eg.row(v), [&](const Graph::Vertex w){ if((u == (Graph::Vertex)-1) || (eg.degree(w) < eg.degree(u))) u = w; });
+    eg.contract(v, u);
+  }
+  return result;
+}
+
+
+struct TreewidthBounds
+{
+  size_t lower_mmw = 0;         // minor-min-width lower bound on the treewidth
+  EliminationResult min_degree; // upper bounds on treewidth & fill-in by min-degree
+  EliminationResult min_fill;   // upper bounds on treewidth & fill-in by min-fill
+
+  size_t upper() const { return std::min(min_degree.width, min_fill.width); }
+  size_t fill_upper() const { return std::min(min_degree.fill, min_fill.fill); }
+};
+
+inline TreewidthBounds treewidth_bounds(const Graph& g, const unsigned threads = 1)
+{
+  TreewidthBounds result;
+  result.lower_mmw = minor_min_width(g);
+  result.min_degree = min_degree_elimination(g);
+  result.min_fill = min_fill_elimination(g, threads);
+  return result;
+}
+
@@ -0,0 +1,93 @@
+
+//! file union_find.hpp
+/** A disjoint-set forest with union by size and path halving, used to keep track of the connected
+ * components of a graph while its edges are inserted. Elements can be added at any time with grow().
+ **/
+
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+class UnionFind
+{
+protected:
+  std::vector<size_t> parent;
+  std::vector<size_t> set_size;
+  size_t sets = 0;
+
+public:
+  UnionFind(const size_t n = 0)
+  {
+    grow(n);
+  }
+
+  //! make sure there are at least n elements, new elements are singletons
+  void grow(const size_t n)
+  {
+    const size_t old_n = parent.size();
+    if(n <= old_n) return;
+    parent.resize(n);
+    std::iota(parent.begin() + old_n, parent.end(), old_n);
+    set_size.resize(n, 1);
+    sets += n - old_n;
+  }
+
+  size_t size() const
+  {
+    return parent.size();
+  }
+
+  size_t num_sets() const
+  {
+    return sets;
+  }
+
+  size_t find(size_t x)
+  {
+    while(parent[x] != x){
+      parent[x] = parent[parent[x]];
+      x = parent[x];
+    }
+    return x;
+  }
+
+  //! merge the sets of x and y, return false if they were in the same set already
+  bool unite(size_t x, size_t y)
+  {
+    x = find(x);
+    y = find(y);
+    if(x == y) return false;
+    if(set_size[x] < set_size[y]) std::swap(x, y);
+    parent[y] = x;
+    set_size[x] += set_size[y];
+    --sets;
+    return true;
+  }
+
+  //! merge all elements in the range into one set
+  template<typename Iter>
+  void unite_all(Iter first, const Iter last)
+  {
+    if(first == last) return;
+    const size_t x = *first;
+    while(++first != last) unite(x, *first);
+  }
+
+  //! number the sets 0, ..., num_sets()-1 in order of their smallest element and return the number of each element
+  std::vector<size_t> set_ids()
+  {
+    const size_t none = -1;
+    std::vector<size_t> root_id(parent.size(), none);
+    std::vector<size_t> result(parent.size());
+    size_t next_id = 0;
+    for(size_t x = 0; x < parent.size(); ++x){
+      size_t& id = root_id[find(x)];
+      if(id == none) id = next_id++;
+      result[x] = id;
+    }
+    return result;
+  }
+};
+
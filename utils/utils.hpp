@@ -93,7 +93,7 @@
 // https://stackoverflow.com/questions/27229371/inverse-error-function-in-c
 // and
 // A handy approximation for the error function and its inverse" by Sergei Winitzki.
-float erf_inv_apx(const float& p)
+inline float erf_inv_apx(const float& p)
 {
   const float sgn = (p < 0) ? -1.0f : 1.0f;
 
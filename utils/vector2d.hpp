@@ -4,22 +4,142 @@
 /** This is a 2 dimentional vector (aka matrix) that is slightly faster than
  * vector<vector<T>> and slightly more convenient than keeping track of the
  * index offsets using vector<T>
+ * Rows of asymmetric matrices are stored consecutively, optionally padded to a multiple of some number of
+ * elements (for example a SIMD width), and can be accessed without copying through strided views.
  **/
 
 #pragma once
 
 #include <cassert>
+#include <cstdlib>
 #include <vector>
+#include <iterator>
+#include <type_traits>
+#include <new>
 
 namespace std{
   class Symmetric;
   class Asymmetric;
 
+  //! an allocator returning memory aligned to Alignment bytes (64 = a cache line or an AVX-512 register)
+  template<typename T, size_t Alignment = 64>
+  struct aligned_allocator
+  {
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef size_t size_type;
+    template<typename U> struct rebind { typedef aligned_allocator<U, Alignment> other; };
+
+    aligned_allocator() {}
+    template<typename U>
+    aligned_allocator(const aligned_allocator<U, Alignment>&) {}
+
+    T* allocate(const size_t n, const void* = 0)
+    {
+      void* result;
+      if(posix_memalign(&result, Alignment, max<size_t>(n, 1) * sizeof(T))) throw bad_alloc();
+      return static_cast<T*>(result);
+    }
+
+    void deallocate(T* const p, const size_t)
+    {
+      free(p);
+    }
+
+    template<typename U>
+    bool operator==(const aligned_allocator<U, Alignment>&) const { return true; }
+    template<typename U>
+    bool operator!=(const aligned_allocator<U, Alignment>&) const { return false; }
+  };
+
+  //! a view of 'count' elements that are 'step' elements apart (a row of a matrix has step 1, a column the row stride)
+  template<typename Element>
+  class strided_view
+  {
+    Element* first;
+    size_t count;
+    size_t step;
+
+  public:
+    class iterator
+    {
+      Element* current;
+      size_t step;
+    public:
+      typedef forward_iterator_tag iterator_category;
+      typedef typename remove_const<Element>::type value_type;
+      typedef ptrdiff_t difference_type;
+      typedef Element* pointer;
+      typedef Element& reference;
+
+      iterator(Element* _current, const size_t _step): current(_current), step(_step) {}
+      Element& operator*() const { return *current; }
+      iterator& operator++() { current += step; return *this; }
+      iterator operator++(int) { const iterator result(*this); current += step; return result; }
+      bool operator==(const iterator& it) const { return current == it.current; }
+      bool operator!=(const iterator& it) const { return current != it.current; }
+    };
+
+    strided_view(Element* const _first, const size_t _count, const size_t _step = 1):
+      first(_first), count(_count), step(_step)
+    {}
+
+    // a view of non-const elements can be used as a view of const elements
+    operator strided_view<const Element>() const { return strided_view<const Element>(first, count, step); }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t stride() const { return step; }
+    //! whether the elements are consecutive in memory, so data() can be passed to kernels expecting arrays
+    bool contiguous() const { return (step == 1) || (count < 2); }
+    Element* data() const { return first; }
+
+    Element& operator[](const size_t i) const { return first[i * step]; }
+    iterator begin() const { return iterator(first, step); }
+    iterator end() const { return iterator(first + count * step, step); }
+  };
+
+  //! a view of the columns [first_col, first_col + cols) and rows [first_row, first_row + rows) of a matrix
+  template<typename Element>
+  class matrix_view
+  {
+    using Coords = pair<size_t, size_t>;
+
+    Element* origin;
+    size_t columns;
+    size_t num_rows;
+    size_t stride;
+
+  public:
+    matrix_view(Element* const _origin, const size_t _columns, const size_t _rows, const size_t _stride):
+      origin(_origin), columns(_columns), num_rows(_rows), stride(_stride)
+    {}
+
+    operator matrix_view<const Element>() const { return matrix_view<const Element>(origin, columns, num_rows, stride); }
+
+    //! NOTE: coordinates are (col, row) as in Something2d
+    Element& operator[](const Coords& coords) const { return origin[coords.second * stride + coords.first]; }
+    Coords size() const { return {columns, num_rows}; }
+    size_t cols() const { return columns; }
+    size_t rows() const { return num_rows; }
+    size_t row_stride() const { return stride; }
+
+    strided_view<Element> row(const size_t r) const { return strided_view<Element>(origin + r * stride, columns, 1); }
+    strided_view<Element> column(const size_t c) const { return strided_view<Element>(origin + c, num_rows, stride); }
+    matrix_view submatrix(const size_t first_col, const size_t first_row, const size_t cols, const size_t rows) const
+    {
+      assert((first_col + cols <= columns) && (first_row + rows <= num_rows));
+      return matrix_view(origin + first_row * stride + first_col, cols, rows, stride);
+    }
+  };
+
   template<typename Element, typename Something = vector<Element>, typename Symmetry = Asymmetric>
   class Something2d : public Something
   {
   protected:
     size_t columns = 0;
+    size_t stride = 0;   // number of elements from one row to the next (columns + padding)
     using Parent = Something;
     using Coords = pair<size_t, size_t>;
 
@@ -28,7 +148,7 @@ namespace std{
     typename enable_if<is_same<Q, Asymmetric>::value, size_t>::type
     linearize(const Coords& coords) const
     {
-      return coords.second * columns + coords.first;
+      return coords.second * stride + coords.first;
     }
 
     template<typename Q = Symmetry>
@@ -44,11 +164,10 @@ namespace std{
   public:
     Something2d(): Something() {}
 
-    Something2d(const size_t cols, const size_t rows, const Element& element = Element()):
-      columns(cols)
+    //! padding: pad each row to a multiple of this many elements (asymmetric matrices only)
+    Something2d(const size_t cols, const size_t rows, const Element& element = Element(), const size_t padding = 1)
     {
-      // reserve size such that we can access the last index (cols-1,rows-1)
-      Something::resize(linearize({cols - 1, rows - 1}) + 1, element);
+      resize(cols, rows, element, padding);
     }
 
     template<typename Q = Symmetry>
@@ -56,7 +175,7 @@ namespace std{
     size() const
     {
       assert(columns > 0);
-      return {columns, Something::size() / columns};
+      return {columns, Something::size() / stride};
     }
     template<typename Q = Symmetry>
     typename enable_if<is_same<Q, Symmetric>::value, Coords>::type
@@ -84,10 +203,23 @@ namespace std{
       return Something::at(linearize(coords));
     }
     
-    void resize(const size_t cols, const size_t rows, const Element& element = Element())
+    //! padding: pad each row to a multiple of this many elements (asymmetric matrices only)
+    /** NOTE: existing elements keep their linear index, not their coordinates **/
+    void resize(const size_t cols, const size_t rows, const Element& element = Element(), const size_t padding = 1)
     {
+      assert((is_same<Symmetry, Asymmetric>::value) || (padding == 1));
       columns = cols;
-      Something::resize(linearize({cols - 1, rows - 1}) + 1, element);
+      stride = (cols + padding - 1) / padding * padding;
+      // reserve size such that we can access the last index (cols-1,rows-1) and the padding of the last row
+      Something::resize(linearize({cols - 1, rows - 1}) + 1 + stride - cols, element);
+    }
+
+    //! remove all elements, keeping the allocated memory for later use
+    void clear()
+    {
+      columns = 0;
+      stride = 0;
+      Something::clear();
     }
     
     size_t rows() const
@@ -98,13 +230,69 @@ namespace std{
     {
       return columns;
     }
+    size_t row_stride() const
+    {
+      return stride;
+    }
+
+    //! views of a row (consecutive in memory), a column (strided), a submatrix or the whole matrix (asymmetric only)
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, strided_view<Element>>::type
+    row(const size_t r)
+    {
+      return strided_view<Element>(Something::data() + r * stride, columns, 1);
+    }
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, strided_view<const Element>>::type
+    row(const size_t r) const
+    {
+      return strided_view<const Element>(Something::data() + r * stride, columns, 1);
+    }
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, strided_view<Element>>::type
+    column(const size_t c)
+    {
+      return strided_view<Element>(Something::data() + c, rows(), stride);
+    }
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, strided_view<const Element>>::type
+    column(const size_t c) const
+    {
+      return strided_view<const Element>(Something::data() + c, rows(), stride);
+    }
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, matrix_view<Element>>::type
+    view()
+    {
+      return matrix_view<Element>(Something::data(), columns, Something::empty() ? 0 : rows(), stride);
+    }
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, matrix_view<const Element>>::type
+    view() const
+    {
+      return matrix_view<const Element>(Something::data(), columns, Something::empty() ? 0 : rows(), stride);
+    }
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, matrix_view<Element>>::type
+    submatrix(const size_t first_col, const size_t first_row, const size_t cols, const size_t rows)
+    {
+      return view().submatrix(first_col, first_row, cols, rows);
+    }
+    template<typename Q = Symmetry>
+    typename enable_if<is_same<Q, Asymmetric>::value, matrix_view<const Element>>::type
+    submatrix(const size_t first_col, const size_t first_row, const size_t cols, const size_t rows) const
+    {
+      return view().submatrix(first_col, first_row, cols, rows);
+    }
   };
 
 
-  template<typename Element>
-  using vector2d = Something2d<Element, vector<Element>, Asymmetric>;
-  template<typename Element>
-  using symmetric_vector2d = Something2d<Element, vector<Element>, Symmetric>;
+  template<typename Element, typename Alloc = allocator<Element>>
+  using vector2d = Something2d<Element, vector<Element, Alloc>, Asymmetric>;
+  template<typename Element, size_t Alignment = 64>
+  using aligned_vector2d = Something2d<Element, vector<Element, aligned_allocator<Element, Alignment>>, Asymmetric>;
+  template<typename Element, typename Alloc = allocator<Element>>
+  using symmetric_vector2d = Something2d<Element, vector<Element, Alloc>, Symmetric>;
 
 
 }// namespace
@@ -0,0 +1,133 @@
+
+//! file windows.hpp
+/** Instances of sliding windows of characters of one alignment (for example windows of 500 characters, every 100):
+ * whether two vertices (c, i) and (d, j) are adjacent only depends on the characters c and d, so the graph of a
+ * window is the subgraph induced by its informative characters. A sweep keeps, for each pair of characters in
+ * the current window, which of their states share a species; this is computed once when the later character
+ * enters the window and forgotten when the earlier one leaves it, so moving the window by k characters costs
+ * k * length pairs instead of length^2 / 2.
+ * The windows are split into consecutive blocks, each swept independently (on its own thread).
+ **/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "utils/utils.hpp"
+#include "utils/graph.hpp"
+#include "utils/subsample.hpp"
+
+// the states of each pair of characters are related by 64-bit masks, so informative characters may have at most this many states
+#define WINDOW_MAX_STATES 64
+
+// the window [first, end) of the characters
+typedef std::pair<size_t, size_t> CharacterWindow;
+
+//! return the windows of the given length starting every step characters that fit into num_chars characters
+//! (or the single window of all characters if there are less than length)
+inline std::vector<CharacterWindow> sliding_windows(const size_t num_chars, const size_t length, const size_t step)
+{
+  assert(length && step);
+  std::vector<CharacterWindow> result;
+  if(num_chars <= length)
+    result.emplace_back(0, num_chars);
+  else
+    for(size_t first = 0; first + length <= num_chars; first += step) result.emplace_back(first, first + length);
+  return result;
+}
+
+class WindowSweep
+{
+public:
+  typedef Graph::Vertex Vertex;
+
+protected:
+  const CharacterStates& states;
+  const std::vector<bool>& informative; // the informative characters (among all species)
+  const std::vector<unsigned>& species; // all species, in order
+  const size_t length;
+  size_t first = 0;
+  size_t end = 0;
+  // pairs[c % length][(d - c - 1) * num_states(c) + i] has bit j set iff state i of c & state j of d share a species
+  std::vector<std::vector<uint64_t>> pairs;
+
+  uint64_t* pair_row(const size_t c, const size_t d)
+  {
+    return pairs[c % length].data() + (d - c - 1) * states.num_states(c);
+  }
+  const uint64_t* pair_row(const size_t c, const size_t d) const
+  {
+    return pairs[c % length].data() + (d - c - 1) * states.num_states(c);
+  }
+
+  void add_character(const size_t d)
+  {
+    std::vector<uint64_t>& slot = pairs[d % length];
+    slot.assign(states.num_states(d) * (length - 1), 0);
+    if(!informative[d]) return;
+    assert(states.num_states(d) <= WINDOW_MAX_STATES);
+    const Vertex d_base = states.first_vertex(d);
+    // the window ends at d, so the characters first, ..., d - 1 are in it
+    for(size_t c = first; c < d; ++c)
+      if(informative[c]){
+        uint64_t* const row = pair_row(c, d);
+        const Vertex c_base = states.first_vertex(c);
+        for(const unsigned s: species) row[states.vertex(s, c) - c_base] |= uint64_t(1) << (states.vertex(s, d) - d_base);
+      }
+  }
+
+public:
+  //! NOTE: each informative character must have at most WINDOW_MAX_STATES states
+  WindowSweep(const CharacterStates& _states, const std::vector<bool>& _informative, const std::vector<unsigned>& _species,
+              const size_t _length):
+    states(_states), informative(_informative), species(_species), length(_length), pairs(_length)
+  {}
+
+  //! move the window to the characters new_first, ..., new_first + length - 1 (new_first can only grow)
+  void advance(const size_t new_first)
+  {
+    assert(new_first >= first);
+    const size_t new_end = std::min(new_first + length, states.num_characters());
+    first = new_first;
+    for(size_t d = std::max(end, new_first); d < new_end; ++d) add_character(d);
+    end = new_end;
+  }
+
+  //! return the instance of the current window, with vertices numbered in order of their first occurrence
+  /** if characters_kept is given, it receives the number of informative characters in the window **/
+  Graph graph(size_t* characters_kept = NULL) const
+  {
+    const Vertex none = -1;
+    const Vertex base = states.first_vertex(first);
+    std::vector<Vertex> local(states.first_vertex(end) - base, none);
+    Vertex n = 0;
+    for(const unsigned s: species)
+      for(size_t ch = first; ch < end; ++ch)
+        if(informative[ch]){
+          Vertex& v = local[states.vertex(s, ch) - base];
+          if(v == none) v = n++;
+        }
+
+    Graph result(n);
+    for(size_t v = 0; v < local.size(); ++v)
+      if(local[v] != none) result.set_name(local[v], states.name(base + v));
+    size_t kept = 0;
+    for(size_t c = first; c < end; ++c){
+      if(!informative[c]) continue;
+      ++kept;
+      const Vertex c_base = states.first_vertex(c) - base;
+      for(size_t d = c + 1; d < end; ++d){
+        if(!informative[d]) continue;
+        const Vertex d_base = states.first_vertex(d) - base;
+        const uint64_t* const row = pair_row(c, d);
+        for(size_t i = 0; i < states.num_states(c); ++i)
+          for(uint64_t bits = row[i]; bits; bits &= bits - 1)
+            result.add_edge(local[c_base + i], local[d_base + __builtin_ctzll(bits)]);
+      }
+    }
+    if(characters_kept) *characters_kept = kept;
+    return result;
+  }
+};
+